@@ -57,6 +57,14 @@ Board::Board(int r, int c) {
   for (int i = 0; i < cols; i++) {
     horizontal_walls[0][i] = horizontal_walls[rows][i] = true;
   }
+
+  // boards that fit in a Line_Mask slide by bit scans (see moveRobot),
+  //  with the east and south borders as walls in the masks
+  masked = rows <= LINE_MASK_BITS && cols <= LINE_MASK_BITS;
+  if (masked) {
+    for (int i = 0; i < rows; i++) east_walls.add(i, cols-1);
+    for (int i = 0; i < cols; i++) south_walls.add(rows-1, i);
+  }
 }
 
 
@@ -102,6 +110,8 @@ void Board::addHorizontalWall(double r, int c) {
   assert (horizontal_walls[floor(r)][c-1] == false);
   // subtract one and round down because the corner is (0,0) not (1,1)
   horizontal_walls[floor(r)][c-1] = true;
+  // the wall on the south side of the cell above it
+  if (masked && floor(r) >= 1) south_walls.add(int(floor(r))-1, c-1);
 }
 
 // Add an interior vertical wall
@@ -115,6 +125,8 @@ void Board::addVerticalWall(int r, double c) {
   assert (vertical_walls[r-1][floor(c)] == false);
   // subtract one and round down because the corner is (0,0) not (1,1)
   vertical_walls[r-1][floor(c)] = true;
+  // the wall on the east side of the cell west of it
+  if (masked && floor(c) >= 1) east_walls.add(r-1, int(floor(c))-1);
 }
 
 
@@ -137,6 +149,11 @@ void Board::setspot(const Position &p, char a) {
   assert (p.col >= 1 && p.col <= cols);
   // subtract one from each coordinate because the corner is (0,0) not (1,1)
   board[p.row-1][p.col-1] = a;
+  // and keep the row and column masks in step
+  if (masked) {
+    if (a == ' ') occupied.remove(p.row-1, p.col-1);
+    else occupied.add(p.row-1, p.col-1);
+  }
 }
 
 char Board::isGoal(const Position &p) const {
@@ -500,18 +517,16 @@ void Board::one_solution(int max_movs, bool moves_given){
 // ==================================================================================
 
 void Board::all_solutions(int max_movs, bool moves_given){
+  if(checkGoals()){ //checks if board is already solved (the one 0 move solution)
+    std::cout << "1 different 0 move solutions:" << std::endl << std::endl;
+    std::cout << "All goals are satisfied after 0 moves" << std::endl << std::endl;
+    return;
+  }
   std::vector<Move> path; //creates path of moves
   int move;
   int* max_moves = new int; //makes max_moves dynamic memory
   *max_moves = max_movs;
   for(unsigned int i = 0; i < robots.size(); ++i){
-    if(checkGoals()){ //checks if board is already solved
-      std::vector<Move> blank_path;
-      blank_path.push_back(Move(-1, "zero_length")); //special case solution
-      Solution new_sol(blank_path);
-      solutions.push_back(new_sol);
-    }
-
     if(*max_moves == 0) continue; //special case
     move = 1;
     one_sol_helper(i, move, max_moves, path); //case where only one robot moves
@@ -577,7 +592,23 @@ bool Board::moveRobot(int i, const std::string &direction) {
   bool stop = false;
   setspot(curr_robot->pos, ' '); //sets old spot to blank initially
 
-  if(direction == "north"){
+  if(masked){
+    //the nearer of the next wall and the next robot, each found with one
+    //  bit scan of the row or column (bits count from 0)
+    if(direction == "north"){
+      robot_row = slideLow(south_walls.col(robot_col-1), occupied.col(robot_col-1), robot_row-1) + 1;
+    }
+    else if(direction == "south"){
+      robot_row = slideHigh(south_walls.col(robot_col-1), occupied.col(robot_col-1), robot_row-1) + 1;
+    }
+    else if(direction == "east"){
+      robot_col = slideHigh(east_walls.row(robot_row-1), occupied.row(robot_row-1), robot_col-1) + 1;
+    }
+    else if(direction == "west"){
+      robot_col = slideLow(east_walls.row(robot_row-1), occupied.row(robot_row-1), robot_col-1) + 1;
+    }
+  }
+  else if(direction == "north"){
     while(!stop){
       if(robot_row <= 0){ //out of bounds
         stop = true;
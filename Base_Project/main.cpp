@@ -31,11 +31,11 @@ duration<double, std::milli> delta(std::string msg = ""){
   if(time_first){
     start_time = high_resolution_clock::now();
     time_first = 0;
-    del = (high_resolution_clock::now() - high_resolution_clock::now()) / 1000;
+    del = duration<double, std::milli>::zero();
   }
   else{
-    del = (high_resolution_clock::now() - start_time) / 1000;
-    if(!silent){std::cout << "  " << msg << ": " << del.count() << " s" << std::endl;}
+    del = high_resolution_clock::now() - start_time; //in ms, printed in s
+    if(!silent){std::cout << "  " << msg << ": " << del.count() / 1000 << " s" << std::endl;}
     start_time = high_resolution_clock::now();
   }
   return del;
@@ -0,0 +1,177 @@
+#include "bfs_solver.h"
+
+// ==================================================================
+// ==================================================================
+// Implementation of the Visited_Table
+
+template <class Key>
+uint64_t Visited_Table<Key>::tag(const Key& key){
+  if(!WIDE) return keyHash(key) + 1;
+  return keyHash(key) | 1;
+}
+
+template <class Key>
+size_t Visited_Table<Key>::home(uint64_t stored) const {
+  return (size_t)((stored * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+template <class Key>
+size_t Visited_Table<Key>::bytes() const {
+  return capacity * (sizeof(std::atomic<uint64_t>) + sizeof(std::atomic<unsigned char>) +
+    (WIDE ? sizeof(Key) : 0) + (paths_on ? sizeof(std::atomic<uint64_t>) : 0));
+}
+
+template <class Key>
+size_t Visited_Table<Key>::bytesAfter(size_t more) const {
+  size_t needed = count.load() + more;
+  size_t grown = capacity ? capacity : 1;
+  while(needed * 2 > grown) grown *= 2;
+  return capacity ? bytes() / capacity * grown : 0;
+}
+
+template <class Key>
+void Visited_Table<Key>::reserve(size_t more){
+  size_t needed = count.load() + more;
+  if(needed * 2 <= capacity) return;
+  size_t grown = capacity ? capacity : 1;
+  while(needed * 2 > grown) grown *= 2; //keep the table at most half full
+
+  std::unique_ptr<std::atomic<uint64_t>[]> old_keys(new std::atomic<uint64_t>[grown]);
+  std::unique_ptr<Key[]> old_wide(WIDE ? new Key[grown] : NULL);
+  std::unique_ptr<std::atomic<unsigned char>[]> old_depths(new std::atomic<unsigned char>[grown]);
+  std::unique_ptr<std::atomic<uint64_t>[]> old_paths(paths_on ? new std::atomic<uint64_t>[grown] : NULL);
+  old_keys.swap(keys);
+  old_wide.swap(wide_keys);
+  old_depths.swap(depths);
+  old_paths.swap(path_counts);
+  size_t old_capacity = capacity;
+  capacity = grown;
+  for(size_t i = 0; i < capacity; ++i){
+    keys[i].store(0, std::memory_order_relaxed);
+    depths[i].store(UNSET, std::memory_order_relaxed);
+    if(paths_on) path_counts[i].store(0, std::memory_order_relaxed);
+  }
+
+  // no worker is running, so the old entries go straight in
+  for(size_t i = 0; i < old_capacity; ++i){
+    uint64_t stored = old_keys[i].load(std::memory_order_relaxed);
+    if(stored == 0) continue;
+    size_t s = home(stored);
+    while(keys[s].load(std::memory_order_relaxed) != 0) s = (s + 1) & (capacity - 1);
+    keys[s].store(stored, std::memory_order_relaxed);
+    if(WIDE) wide_keys[s] = old_wide[i];
+    depths[s].store(old_depths[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if(paths_on) path_counts[s].store(old_paths[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+}
+
+// For a wide key whose tag is in slot: is it key?  The claimer publishes
+// the full key with the depth, so this waits out a claim in progress.
+template <class Key>
+bool Visited_Table<Key>::holds(size_t slot, const Key& key) const {
+  if(!WIDE) return true;
+  while(depths[slot].load(std::memory_order_acquire) == UNSET) std::this_thread::yield();
+  return wide_keys[slot] == key;
+}
+
+template <class Key>
+bool Visited_Table<Key>::insert(const Key& key, int depth, size_t& slot){
+  uint64_t stored = tag(key);
+  for(slot = home(stored); ; slot = (slot + 1) & (capacity - 1)){ //linear probing
+    uint64_t seen = keys[slot].load(std::memory_order_relaxed);
+    if(seen == 0){
+      // try to claim the empty slot; if another worker gets it first,
+      //  seen holds whatever it wrote and is checked below
+      if(keys[slot].compare_exchange_strong(seen, stored)){
+        if(WIDE) wide_keys[slot] = key;
+        depths[slot].store(depth, WIDE ? std::memory_order_release : std::memory_order_relaxed);
+        ++count;
+        return true;
+      }
+    }
+    if(seen == stored && holds(slot, key)) return false;
+  }
+}
+
+template <class Key>
+size_t Visited_Table<Key>::find(const Key& key) const {
+  uint64_t stored = tag(key);
+  for(size_t s = home(stored); ; s = (s + 1) & (capacity - 1)){
+    uint64_t seen = keys[s].load(std::memory_order_relaxed);
+    if(seen == 0) return capacity;
+    if(seen == stored && holds(s, key)) return s;
+  }
+}
+
+template <class Key>
+int Visited_Table<Key>::depth(const Key& key) const {
+  size_t s = find(key);
+  return s == capacity ? -1 : depths[s].load(std::memory_order_relaxed);
+}
+
+template <class Key>
+bool Visited_Table<Key>::claimedAt(size_t slot, int depth) const {
+  // every earlier level's depths were written before its barrier, so an
+  //  UNSET depth can only belong to a state claimed in this level
+  int d = depths[slot].load(std::memory_order_relaxed);
+  return d == depth || d == UNSET;
+}
+
+template <class Key>
+uint64_t Visited_Table<Key>::paths(const Key& key) const {
+  assert (paths_on);
+  size_t s = find(key);
+  return s == capacity ? 0 : path_counts[s].load(std::memory_order_relaxed);
+}
+
+template <class Key>
+void Visited_Table<Key>::clear(){
+  keys.reset();
+  wide_keys.reset();
+  depths.reset();
+  path_counts.reset();
+  capacity = 0;
+  count = 0;
+  reserve(1 << 15);
+}
+
+template <class Key>
+void Visited_Table<Key>::save(Checkpoint_Writer& out) const {
+  out.u64(count.load());
+  for(size_t s = 0; s < capacity; ++s){
+    uint64_t stored = keys[s].load(std::memory_order_relaxed);
+    if(stored == 0) continue;
+    if(WIDE) out.bytes(&wide_keys[s], sizeof(Key));
+    else {
+      uint64_t k = stored - 1;
+      out.bytes(&k, sizeof(k));
+    }
+    out.u8(depths[s].load(std::memory_order_relaxed));
+    if(paths_on) out.u64(path_counts[s].load(std::memory_order_relaxed));
+  }
+}
+
+template <class Key>
+bool Visited_Table<Key>::load(Checkpoint_Reader& in, int last, std::vector<Key>& frontier){
+  assert (count.load() == 0);
+  uint64_t states;
+  if(!in.u64(states)) return false;
+  reserve(states);
+  for(uint64_t n = 0; n < states; ++n){
+    Key k;
+    unsigned char d;
+    uint64_t p = 0;
+    if(!in.bytes(&k, sizeof(k)) || !in.u8(d)) return false;
+    if(paths_on && !in.u64(p)) return false;
+    size_t slot;
+    if(!insert(k, d, slot)) return false; //a key twice
+    if(paths_on) addPaths(slot, p);
+    if(d == last) frontier.push_back(k);
+  }
+  return true;
+}
+
+// one per key width the cores in solver_core.cpp use
+template class Visited_Table<uint64_t>;
+template class Visited_Table<Wide_Key<2> >;
+template class Visited_Table<Wide_Key<4> >;
@@ -0,0 +1,597 @@
+#ifndef __bfs_solver_h_
+#define __bfs_solver_h_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <cstdint>
+#include "solver_core.h"
+#include "checkpoint.h"
+
+// ==================================================================
+// ==================================================================
+// Concurrent visited table for the parallel BFS: open addressing on
+// the packed state key, claimed with a compare-and-swap so any number
+// of workers can insert at once.  It never grows while workers are
+// inserting; reserve() is called between the slices of a level instead.
+// With path counting on, every state also keeps how many shortest move
+// sequences reach it (modulo 2^64).  A one word key is the slot's tag
+// itself; a wider one is claimed by its keyHash() as the tag and then
+// written out beside it, and a match on the tag alone is only a
+// candidate until the full key compares equal.
+
+template <class Key>
+class Visited_Table {
+public:
+  Visited_Table(bool with_paths = false) : paths_on(with_paths), capacity(0), count(0) {
+    reserve(1 << 15);
+  }
+  // claims key at depth, false if some worker already had it; either
+  //  way slot is where key is
+  bool insert(const Key& key, int depth, size_t& slot);
+  // depth key was first reached at, or -1 if it was never reached
+  int depth(const Key& key) const;
+  // true if the state in slot was (or is being) claimed at depth
+  bool claimedAt(size_t slot, int depth) const;
+  // shortest paths into a state (only with path counting on)
+  void addPaths(size_t slot, uint64_t n) { path_counts[slot].fetch_add(n, std::memory_order_relaxed); }
+  uint64_t paths(const Key& key) const;
+  // make room for this many more states (not thread safe)
+  void reserve(size_t more);
+  size_t size() const { return count.load(); }
+  // how many more states fit with the table still at most half full
+  size_t room() const { return capacity / 2 - std::min(capacity / 2, count.load()); }
+  size_t bytes() const; //every slot, empty or not
+  size_t bytesAfter(size_t more) const; //what reserve(more) would make it
+  // the table into a checkpoint: u64 states, then per state its key, u8
+  //  depth and (with path counting on) u64 paths; load() puts one back
+  //  into an empty table, with the keys at depth last in frontier, and is
+  //  false if the checkpoint ends first (neither is thread safe)
+  void save(Checkpoint_Writer& out) const;
+  void clear(); //back to empty
+  bool load(Checkpoint_Reader& in, int last, std::vector<Key>& frontier);
+
+private:
+  static const bool WIDE = !std::is_same<Key, uint64_t>::value;
+  static uint64_t tag(const Key& key);
+  size_t home(uint64_t stored) const;
+  size_t find(const Key& key) const; //slot of key, or capacity if missing
+  bool holds(size_t slot, const Key& key) const;
+  static const unsigned char UNSET = 0xFF;
+  bool paths_on;
+  // tags are never 0, so that 0 can mean an empty slot; a depth is UNSET
+  //  until its claimer has written it (and, for a wide key, the key)
+  std::unique_ptr<std::atomic<uint64_t>[]> keys;
+  std::unique_ptr<Key[]> wide_keys; //only for wide keys
+  std::unique_ptr<std::atomic<unsigned char>[]> depths;
+  std::unique_ptr<std::atomic<uint64_t>[]> path_counts;
+  size_t capacity;
+  std::atomic<size_t> count;
+};
+
+
+// ==================================================================
+// ==================================================================
+// Level-synchronous breadth first search over a Solver_Core.  Each
+// level's frontier is split into chunks that the workers take in turn;
+// a worker expands its chunks into its own next-frontier buffer and
+// claims new states in the shared Visited_Table.  At the level barrier
+// the buffers are concatenated into the next frontier.  Once a level
+// holds a solved state, every shortest solution is read back out of
+// the table by walking from the solved states to the start; that walk is
+// split into subtrees a few levels back from the goals, which the workers
+// share out and whose results are merged in task order.  For a count
+// alone, each state instead sums the path counts of its parents as it
+// is reached, and no path is ever built.  For all_targets there are no
+// goals: every level is expanded, and the first level that puts a robot
+// on a cell keeps the smallest key of the states that do, from which one
+// path back is walked at the end.  With a Checkpoint_Config, run() and
+// count() write the visited table out at level barriers, and a resumed
+// search reloads it and takes the deepest level in it as its frontier:
+// a level's order only decides the order the solutions are found in,
+// and they are printed sorted.
+
+template <class Core>
+class Parallel_BFS {
+public:
+  typedef typename Core::State State;
+  typedef typename Core::Key Key;
+
+  Parallel_BFS(const Core& c, int threads, bool count_paths = false) :
+    core(c), num_threads(threads), counting(count_paths), targeting(false), visited(count_paths),
+    expanded(0), mem_limit(0), out_of_memory(false) {}
+  // every shortest solution with at most max_moves moves goes into found
+  void run(int max_moves, Sol_Arena& arena, std::vector<Sol_Span>& found);
+  // how many shortest solutions there are with at most max_moves moves,
+  //  and how long they are (needs count_paths)
+  uint64_t count(int max_moves, int& length);
+  // fewest moves for each robot to each cell and a path for each (see
+  //  Core_Solver::all_targets)
+  void targets(int max_moves, Sol_Arena& arena, std::vector<int>& depth,
+    std::vector<Sol_Span>& witness);
+  // what the search kept, once it is done
+  Core_Stats stats() const;
+  void setCheckpoint(const Checkpoint_Config& config) { checkpoint = config; }
+  // stop (with nothing found and out_of_memory in the stats) rather than
+  //  let the table and frontiers grow past bytes
+  void setMemLimit(size_t bytes) { mem_limit = bytes; }
+
+private:
+  // a state on some shortest solution and the moves from it to the goal
+  class Enum_Task {
+  public:
+    State s;
+    int depth;
+    std::vector<PackedMove> tail;
+  };
+  // one enumerating worker's scratch path and the arena it records into
+  class Enum_Worker {
+  public:
+    PackedMove path[CORE_MAX_MOVES + 1];
+    Sol_Arena arena;
+  };
+
+  int search(int max_moves);
+  int resume();
+  void save(int depth);
+  bool fits(size_t table_bytes, size_t frontier_states) const;
+  void expand(int depth, int worker);
+  template <class Visit> void parents(State& s, int depth, Visit visit);
+  void reachTargets(const State& s, int worker);
+  bool settleTargets(int depth);
+  void enumerateTasks(int worker);
+  void enumerate(State& s, int depth, Enum_Worker& w, std::vector<Sol_Span>& out);
+
+  const Core& core;
+  int num_threads;
+  bool counting;
+  bool targeting;
+  Visited_Table<Key> visited;
+
+  // the solved states of the first level that has any
+  std::vector<State> goals;
+
+  // the level being expanded, a slice at a time up to slice_end, split
+  //  up with next_chunk
+  std::vector<State> frontier;
+  size_t slice_end;
+  std::atomic<size_t> next_chunk;
+  // per-worker output of the current level
+  std::vector<std::vector<State> > next_buffers;
+  std::vector<std::vector<State> > goal_buffers;
+  std::atomic<uint64_t> expanded; //frontier states, over every level
+
+  // enumeration: the subtrees, taken in turn with next_task, and what
+  //  was found under each one
+  int goal_depth;
+  std::vector<Enum_Task> tasks;
+  std::atomic<size_t> next_task;
+  std::vector<std::vector<Sol_Span> > task_found;
+  std::vector<std::unique_ptr<Enum_Worker> > enum_workers;
+
+  // all_targets, by robot * cells + cell: the level first reached at (-1
+  //  until then), the smallest key of that level's states that got there
+  //  (so the witness never depends on which worker got there first), and
+  //  how many are still unreached.  Each worker offers its own smallest
+  //  key of the level, and the barrier keeps the smallest offer.
+  std::vector<int> target_depth;
+  std::vector<Key> target_key;
+  std::vector<std::vector<Key> > offer_key;
+  std::vector<std::vector<unsigned char> > offered;
+  size_t targets_left;
+
+  Checkpoint_Config checkpoint;
+  Core_Stats checkpoint_stats; //only its checkpoint fields
+  size_t mem_limit;
+  bool out_of_memory;
+};
+
+
+template <class Core>
+void Parallel_BFS<Core>::run(int max_moves, Sol_Arena& arena, std::vector<Sol_Span>& found){
+  assert (max_moves <= CORE_MAX_MOVES);
+  if(core.solved(core.start())){
+    found.push_back(arena.record(NULL, 0));
+    return;
+  }
+  goal_depth = search(max_moves);
+  if(!checkpoint.filename.empty()) std::remove(checkpoint.filename.c_str());
+  if(goals.empty()) return;
+
+  // step back from the goals a level at a time until there are enough
+  //  subtrees to go around (the goals are in key order, so the order
+  //  they come out in never depends on timing)
+  for(unsigned int g = 0; g < goals.size(); ++g){
+    Enum_Task t;
+    t.s = goals[g];
+    t.depth = goal_depth;
+    tasks.push_back(t);
+  }
+  while(tasks.size() < 8 * (size_t)num_threads && tasks[0].depth > 0){
+    std::vector<Enum_Task> split;
+    for(unsigned int t = 0; t < tasks.size(); ++t){
+      const Enum_Task& task = tasks[t];
+      State s = task.s;
+      parents(s, task.depth, [&](PackedMove move){
+        Enum_Task u;
+        u.s = s;
+        u.depth = task.depth - 1;
+        u.tail.push_back(move);
+        u.tail.insert(u.tail.end(), task.tail.begin(), task.tail.end());
+        split.push_back(u);
+      });
+    }
+    tasks.swap(split);
+  }
+
+  task_found.resize(tasks.size());
+  next_task = 0;
+  std::vector<std::thread> workers;
+  for(int w = 0; w < num_threads; ++w) enum_workers.push_back(std::unique_ptr<Enum_Worker>(new Enum_Worker));
+  for(int w = 1; w < num_threads; ++w){
+    workers.push_back(std::thread(&Parallel_BFS::enumerateTasks, this, w));
+  }
+  enumerateTasks(0);
+  for(unsigned int w = 0; w < workers.size(); ++w) workers[w].join();
+
+  // merge in task order into the caller's arena (the workers' go with them)
+  for(unsigned int t = 0; t < task_found.size(); ++t){
+    for(unsigned int f = 0; f < task_found[t].size(); ++f){
+      found.push_back(arena.record(task_found[t][f].moves, task_found[t][f].length));
+    }
+  }
+}
+
+template <class Core>
+uint64_t Parallel_BFS<Core>::count(int max_moves, int& length){
+  assert (counting && max_moves <= CORE_MAX_MOVES);
+  if(core.solved(core.start())){
+    length = 0;
+    return 1;
+  }
+  length = search(max_moves);
+  if(!checkpoint.filename.empty()) std::remove(checkpoint.filename.c_str());
+  uint64_t total = 0;
+  for(unsigned int g = 0; g < goals.size(); ++g) total += visited.paths(core.key(goals[g]));
+  return total;
+}
+
+template <class Core>
+void Parallel_BFS<Core>::targets(int max_moves, Sol_Arena& arena, std::vector<int>& depth,
+    std::vector<Sol_Span>& witness){
+  assert (max_moves <= CORE_MAX_MOVES);
+  targeting = true;
+  size_t pairs = (size_t)core.robots() * core.rows() * core.cols();
+  target_depth.assign(pairs, -1);
+  target_key.assign(pairs, Key());
+  offer_key.assign(num_threads, std::vector<Key>(pairs));
+  offered.assign(num_threads, std::vector<unsigned char>(pairs, 0));
+  targets_left = pairs;
+  reachTargets(core.start(), 0);
+  settleTargets(0);
+  search(max_moves);
+
+  // one path to each, back from its state through the first parent found
+  PackedMove path[CORE_MAX_MOVES + 1];
+  depth = target_depth;
+  witness.assign(pairs, Sol_Span());
+  for(size_t t = 0; t < pairs; ++t){
+    if(target_depth[t] < 0) continue;
+    State s = core.unkey(target_key[t]);
+    for(int d = target_depth[t]; d > 0; --d){
+      bool taken = false;
+      State parent = s;
+      parents(s, d, [&](PackedMove move){
+        if(taken) return;
+        taken = true;
+        path[d-1] = move;
+        parent = s;
+      });
+      assert (taken);
+      s = parent;
+    }
+    witness[t] = arena.record(path, target_depth[t]);
+  }
+}
+
+template <class Core>
+Core_Stats Parallel_BFS<Core>::stats() const {
+  Core_Stats st;
+  st.states = visited.size();
+  st.expanded = expanded.load();
+  st.table_bytes = visited.bytes();
+  st.state_bytes = sizeof(State);
+  st.key_bytes = sizeof(Key);
+  st.checkpoints = checkpoint_stats.checkpoints;
+  st.checkpoint_bytes = checkpoint_stats.checkpoint_bytes;
+  st.checkpoint_failed = checkpoint_stats.checkpoint_failed;
+  st.resumed_depth = checkpoint_stats.resumed_depth;
+  st.checkpoint_ignored = checkpoint_stats.checkpoint_ignored;
+  st.mem_limit = mem_limit;
+  st.out_of_memory = out_of_memory;
+  return st;
+}
+
+// Offers s for every robot's cell that no earlier level reached
+template <class Core>
+void Parallel_BFS<Core>::reachTargets(const State& s, int worker){
+  Key k = core.key(s);
+  int cells = core.rows() * core.cols();
+  std::vector<Key>& best = offer_key[worker];
+  std::vector<unsigned char>& any = offered[worker];
+  for(int i = 0; i < core.robots(); ++i){
+    size_t t = (size_t)i * cells + s.cell[i];
+    if(target_depth[t] >= 0) continue;
+    if(!any[t] || k < best[t]){
+      best[t] = k;
+      any[t] = 1;
+    }
+  }
+}
+
+// At the level barrier: what this level reached is now at depth; false
+// once every robot has been on every cell
+template <class Core>
+bool Parallel_BFS<Core>::settleTargets(int depth){
+  for(size_t t = 0; t < target_depth.size(); ++t){
+    if(target_depth[t] >= 0) continue;
+    for(int w = 0; w < num_threads; ++w){
+      if(!offered[w][t]) continue;
+      offered[w][t] = 0;
+      if(target_depth[t] < 0 || offer_key[w][t] < target_key[t]) target_key[t] = offer_key[w][t];
+      if(target_depth[t] < 0) --targets_left;
+      target_depth[t] = depth;
+    }
+  }
+  return targets_left > 0;
+}
+
+// Expands a level at a time until one has solved states, leaving them in
+// goals; returns that level's depth, or -1 if max_moves is reached first
+// (for all_targets, every level to max_moves is expanded)
+template <class Core>
+int Parallel_BFS<Core>::search(int max_moves){
+  int first = resume() + 1;
+  if(first == 1){
+    size_t slot;
+    frontier.assign(1, core.start());
+    visited.insert(core.key(core.start()), 0, slot);
+    if(counting) visited.addPaths(slot, 1);
+  }
+  std::chrono::steady_clock::time_point saved = std::chrono::steady_clock::now();
+  next_buffers.resize(num_threads);
+  goal_buffers.resize(num_threads);
+
+  // every state in the frontier adds at most 4 per robot, and a level is
+  //  expanded in slices the table has that much room for, so it only
+  //  grows as it fills instead of for every level's worst case
+  const size_t MIN_SLICE = 1024;
+  size_t worst = 4 * core.robots();
+  for(int depth = first; depth <= max_moves && !frontier.empty(); ++depth){
+    for(size_t begin = 0; begin < frontier.size(); begin = slice_end){
+      size_t left = frontier.size() - begin;
+      if(visited.room() < std::min(left, MIN_SLICE) * worst){
+        size_t more = std::min(left, MIN_SLICE) * worst;
+        // growing holds the old table and the new one at once
+        if(!fits(visited.bytes() + visited.bytesAfter(more), 2 * frontier.size())){
+          out_of_memory = true;
+          return -1;
+        }
+        visited.reserve(more);
+      }
+      slice_end = begin + std::min(left, visited.room() / worst);
+      next_chunk = begin;
+      std::vector<std::thread> workers;
+      for(int w = 1; w < num_threads; ++w){
+        workers.push_back(std::thread(&Parallel_BFS::expand, this, depth, w));
+      }
+      expand(depth, 0);
+      for(unsigned int w = 0; w < workers.size(); ++w) workers[w].join();
+    }
+
+    // level barrier: gather the goals, in key order rather than the order
+    //  the workers happened to find them in, or else build the next frontier
+    for(int w = 0; w < num_threads; ++w){
+      goals.insert(goals.end(), goal_buffers[w].begin(), goal_buffers[w].end());
+      goal_buffers[w].clear();
+    }
+    std::sort(goals.begin(), goals.end(), [&](const State& a, const State& b){
+      return core.key(a) < core.key(b);
+    });
+    if(targeting && !settleTargets(depth)) return -1;
+    if(!goals.empty()) return depth;
+    size_t total = 0;
+    for(int w = 0; w < num_threads; ++w) total += next_buffers[w].size();
+    if(!fits(visited.bytes(), frontier.size() + 2 * total)){
+      out_of_memory = true;
+      return -1;
+    }
+    frontier.clear();
+    frontier.reserve(total);
+    for(int w = 0; w < num_threads; ++w){
+      frontier.insert(frontier.end(), next_buffers[w].begin(), next_buffers[w].end());
+      next_buffers[w].clear();
+    }
+    if(!checkpoint.filename.empty() && !targeting &&
+        std::chrono::steady_clock::now() - saved >= std::chrono::seconds(checkpoint.every_seconds)){
+      save(depth);
+      saved = std::chrono::steady_clock::now();
+    }
+  }
+  return -1;
+}
+
+// Whether a table of table_bytes and frontier_states states in frontiers
+// and buffers are within the memory limit
+template <class Core>
+bool Parallel_BFS<Core>::fits(size_t table_bytes, size_t frontier_states) const {
+  return mem_limit == 0 || table_bytes + frontier_states * sizeof(State) <= mem_limit;
+}
+
+// The table and frontier of checkpoint.filename, if resuming from it;
+// returns the level it ends at, or 0 (with everything still empty) to
+// start from scratch
+template <class Core>
+int Parallel_BFS<Core>::resume(){
+  if(!checkpoint.resume || checkpoint.filename.empty() || targeting) return 0;
+  Checkpoint_Reader in;
+  if(!in.open(checkpoint.filename)) return 0;
+  int depth;
+  std::vector<Key> keys;
+  if(!readCheckpointHeader(in, core, counting ? CHECKPOINT_COUNT : CHECKPOINT_BFS, depth) ||
+      depth < 1 || !visited.load(in, depth, keys)){
+    visited.clear();
+    checkpoint_stats.checkpoint_ignored = true;
+    return 0;
+  }
+  frontier.clear();
+  for(size_t k = 0; k < keys.size(); ++k) frontier.push_back(core.unkey(keys[k]));
+  checkpoint_stats.resumed_depth = depth;
+  return depth;
+}
+
+// Checkpoints the search at the barrier after level depth
+template <class Core>
+void Parallel_BFS<Core>::save(int depth){
+  Checkpoint_Writer out;
+  bool ok = out.open(checkpoint.filename);
+  if(ok){
+    writeCheckpointHeader(out, core, counting ? CHECKPOINT_COUNT : CHECKPOINT_BFS, depth);
+    visited.save(out);
+    ok = out.commit();
+  }
+  if(!ok){
+    checkpoint_stats.checkpoint_failed = true;
+    return;
+  }
+  ++checkpoint_stats.checkpoints;
+  checkpoint_stats.checkpoint_bytes = out.written();
+}
+
+// One worker's share of a slice of a level: take chunks of the frontier
+// until the slice runs out, keeping every state it is the first to reach
+template <class Core>
+void Parallel_BFS<Core>::expand(int depth, int worker){
+  const size_t CHUNK = 256;
+  std::vector<State>& next = next_buffers[worker];
+  std::vector<State>& solved = goal_buffers[worker];
+  for(;;){
+    size_t begin = next_chunk.fetch_add(CHUNK);
+    if(begin >= slice_end) break;
+    size_t end = std::min(begin + CHUNK, slice_end);
+    expanded += end - begin;
+    for(size_t f = begin; f < end; ++f){
+      State s = frontier[f];
+      // this level's counts are final, the parents' were done last level
+      uint64_t paths_in = counting ? visited.paths(core.key(s)) : 0;
+      for(int i = 0; i < core.robots(); ++i){
+        int from = s.cell[i];
+        for(int dir = 0; dir < 4; ++dir){
+          int to = core.slide(s, i, dir);
+          if(to == from) continue;
+          s.cell[i] = to;
+          size_t slot;
+          if(visited.insert(core.key(s), depth, slot)){
+            if(targeting){
+              reachTargets(s, worker);
+              next.push_back(s);
+            }
+            else if(core.solved(s)) solved.push_back(s);
+            else next.push_back(s);
+          }
+          // every parent in the level above adds its paths, whoever claimed it
+          if(counting && visited.claimedAt(slot, depth)) visited.addPaths(slot, paths_in);
+          s.cell[i] = from;
+        }
+      }
+    }
+  }
+}
+
+// Calls visit(move) once for every state one move shallower than s (at
+// depth) that move takes to s, with s changed to that state for the call
+template <class Core>
+template <class Visit>
+void Parallel_BFS<Core>::parents(State& s, int depth, Visit visit){
+  for(int i = 0; i < core.robots(); ++i){
+    int to = s.cell[i];
+    for(int dir = 0; dir < 4; ++dir){
+      // robot i only got here sliding in dir if it would stop here
+      if(core.slide(s, i, dir) != to) continue;
+      // and it started anywhere behind it, up to the first wall or robot
+      int far = core.wallStop(oppositeDir(dir), to);
+      for(int from = to; from != far; ){
+        from -= core.step(dir);
+        if(core.occupied(s, from, i)) break;
+        s.cell[i] = from;
+        if(visited.depth(core.key(s)) == depth-1) visit((PackedMove)((i << 2) | dir));
+      }
+      s.cell[i] = to;
+    }
+  }
+}
+
+// One worker's share of the enumeration: take subtrees until none are left
+template <class Core>
+void Parallel_BFS<Core>::enumerateTasks(int worker){
+  Enum_Worker& w = *enum_workers[worker];
+  for(size_t t = next_task++; t < tasks.size(); t = next_task++){
+    State s = tasks[t].s;
+    int depth = tasks[t].depth;
+    std::copy(tasks[t].tail.begin(), tasks[t].tail.end(), w.path + depth);
+    enumerate(s, depth, w, task_found[t]);
+  }
+}
+
+// Walks back from a state at depth to the start through every state one
+// move shallower that slides into it, recording each complete path
+template <class Core>
+void Parallel_BFS<Core>::enumerate(State& s, int depth, Enum_Worker& w,
+    std::vector<Sol_Span>& out){
+  if(depth == 0){
+    out.push_back(w.arena.record(w.path, goal_depth));
+    return;
+  }
+  parents(s, depth, [&](PackedMove move){
+    w.path[depth-1] = move;
+    enumerate(s, depth-1, w, out);
+  });
+}
+
+// The BFS for one specialization of the core
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+void Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::bfs_solutions(int max_moves, int num_threads,
+    Sol_Arena& arena, std::vector<Sol_Span>& found){
+  Parallel_BFS<Solver_Core> bfs(*this, num_threads);
+  bfs.setCheckpoint(checkpoint);
+  bfs.setMemLimit(mem_limit);
+  bfs.run(max_moves, arena, found);
+  last_stats = bfs.stats();
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+void Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::all_targets(int max_moves, int num_threads,
+    Sol_Arena& arena, std::vector<int>& depth, std::vector<Sol_Span>& witness){
+  Parallel_BFS<Solver_Core> bfs(*this, num_threads);
+  bfs.setMemLimit(mem_limit);
+  bfs.targets(max_moves, arena, depth, witness);
+  last_stats = bfs.stats();
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+uint64_t Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::count_solutions(int max_moves, int num_threads,
+    int& length){
+  Parallel_BFS<Solver_Core> bfs(*this, num_threads, true);
+  bfs.setCheckpoint(checkpoint);
+  bfs.setMemLimit(mem_limit);
+  uint64_t total = bfs.count(max_moves, length);
+  last_stats = bfs.stats();
+  return total;
+}
+
+#endif
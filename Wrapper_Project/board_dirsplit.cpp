@@ -2,14 +2,54 @@
 #include <cstdlib>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <ctime>
 #include <mutex> // https://en.cppreference.com/w/cpp/thread/lock_guard
 #include <map>
 #include "board_dirsplit.h"
+#include "solver_core.h"
+#include "profile.h"
+#include "sol_format.h"
+#include "distance_table.h"
 
 // protects the cache coherency of the all states variable when in checkStates
 std::mutex stateMutex;
 
+// Lowers the bound every search thread shares to a solution's length.  A
+// thread that read the bound before a shorter solution was recorded must
+// not raise it back, so only a smaller value is ever stored
+static void tightenMaxMoves(std::atomic<int>* max_moves, int move){
+  int bound = *max_moves;
+  while(move < bound && !max_moves->compare_exchange_weak(bound, move)){}
+}
+
+// Times one search thread's root task into its board's Search_Stats
+class Stats_Timer {
+public:
+  Stats_Timer(Search_Stats& s, const char* task, int robot) : stats(s) {
+    stats.task = task;
+    stats.robot = robot;
+    wall_start = std::chrono::steady_clock::now();
+    cpu_start = threadCpuMs();
+  }
+  ~Stats_Timer(){
+    std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - wall_start;
+    stats.wall_ms = wall.count();
+    stats.cpu_ms = threadCpuMs() - cpu_start;
+  }
+private:
+  static double threadCpuMs(){
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+  }
+  Search_Stats& stats;
+  std::chrono::steady_clock::time_point wall_start;
+  double cpu_start;
+};
+
 // ==================================================================
 // ==================================================================
 // Implementation of the Position class
@@ -40,18 +80,10 @@ Sol_Singleton* Sol_Singleton::getInstance(){
   return instance;
 }
 
-void Sol_Singleton::addState(std::string key, Solution sol){
-  all_solutions.insert(std::make_pair(key, sol));
-}
-
 void Sol_Singleton::addStateToAllStates(std::string key, Solution sol){
   all_states.insert(std::make_pair(key, sol));
 }
 
-void Sol_Singleton::addBoardToAllBoards(std::string key){
-  all_boards.insert(std::make_pair(key,true));
-}
-
 std::string Solution::getKey(){
   std::string key = "";
   for(Move mv : path){
@@ -61,6 +93,95 @@ std::string Solution::getKey(){
   return key;
 }
 
+// ==================================================================
+// ==================================================================
+// Implementation of the packed moves and the solution arena
+
+// direction names in the order they sort, indexed by the packed direction
+static const std::string packed_dirs[4] = {"east", "north", "south", "west"};
+
+PackedMove packMove(int robot_index, const std::string &direction){
+  assert (robot_index >= 0 && robot_index < 64);
+  int dir = 0;
+  while(dir < 3 && packed_dirs[dir] != direction) ++dir;
+  assert (packed_dirs[dir] == direction);
+  return (PackedMove)((robot_index << 2) | dir);
+}
+
+int packedRobot(PackedMove pm){
+  return pm >> 2;
+}
+
+const std::string& packedDirection(PackedMove pm){
+  return packed_dirs[pm & 3];
+}
+
+// Where each packed move falls in getKey() order.  getKey() writes a move
+// as the robot's index in decimal and then the direction's name, so with
+// ten or more robots the bytes do not sort that way ("11east" < "1east" <
+// "2east"); no move's text is the start of another's, so ranking the moves
+// by their texts once ranks the paths the way their keys compare.
+static const std::vector<unsigned char>& packedRanks(){
+  static const std::vector<unsigned char> ranks = [](){
+    std::vector<std::string> text(256);
+    std::vector<int> order(256);
+    for(int pm = 0; pm < 256; ++pm){
+      text[pm] = std::to_string(packedRobot(pm)) + packedDirection(pm);
+      order[pm] = pm;
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b){ return text[a] < text[b]; });
+    std::vector<unsigned char> r(256);
+    for(int i = 0; i < 256; ++i) r[order[i]] = i;
+    return r;
+  }();
+  return ranks;
+}
+
+bool operator<(const Sol_Span &a, const Sol_Span &b){
+  const std::vector<unsigned char>& ranks = packedRanks();
+  return std::lexicographical_compare(a.moves, a.moves + a.length,
+    b.moves, b.moves + b.length, [&](PackedMove x, PackedMove y){ return ranks[x] < ranks[y]; });
+}
+
+bool operator==(const Sol_Span &a, const Sol_Span &b){
+  return a.length == b.length && std::equal(a.moves, a.moves + a.length, b.moves);
+}
+
+Sol_Span Sol_Arena::record(const std::vector<Move>& path){
+  PackedMove* dest = allocate(path.size());
+  for(unsigned int q = 0; q < path.size(); ++q){
+    dest[q] = packMove(path[q].robot_index, path[q].direction);
+  }
+  return Sol_Span(dest, path.size());
+}
+
+Sol_Span Sol_Arena::record(const PackedMove* moves, unsigned int length){
+  PackedMove* dest = allocate(length);
+  std::copy(moves, moves + length, dest);
+  return Sol_Span(dest, length);
+}
+
+PackedMove* Sol_Arena::allocate(unsigned int length){
+  assert (length <= BLOCK_SIZE);
+  //start a new block when the path does not fit in what is left of this one
+  //  (or there is no block yet, even for a 0 move path)
+  if(blocks.empty() || used + length > BLOCK_SIZE){
+    blocks.push_back(new PackedMove[BLOCK_SIZE]);
+    used = 0;
+  }
+  PackedMove* dest = blocks.back() + used;
+  used += length;
+  return dest;
+}
+
+void Sol_Arena::release(){
+  for(unsigned int b = 0; b < blocks.size(); ++b){
+    delete [] blocks[b];
+  }
+  blocks.clear();
+  used = BLOCK_SIZE;
+}
+
 // ===================
 // CONSTRUCTOR
 // ===================
@@ -68,24 +189,21 @@ std::string Solution::getKey(){
 Board_Threads::Board::Board(){
   rows = 0;
   cols = 0;
+  hash = 0;
+  ordering = true;
 }
 
 Board_Threads::Board::~Board(){}
 
-Board_Threads::Board::Board(int r, int c) { 
-  // initialize the dimensions
-  rows = r; 
-  cols = c; 
-
-  // allocate space for the contents of each grid cell
-  board = std::vector<std::vector<char> >(rows,std::vector<char>(cols,' '));
+Board_Layout::Board_Layout(int rows, int cols){
+  assert (rows > 0 && rows <= BOARD_MAX_DIM);
+  assert (cols > 0 && cols <= BOARD_MAX_DIM);
 
-  // allocate space for booleans indicating the presense of each wall
-  // by default, these are false == no wall
-  // (note that there must be an extra column of vertical walls
+  // by default, there are no walls
+  // (note that there is an extra column of vertical walls
   //  and an extra row of horizontal walls)
-  vertical_walls = std::vector<std::vector<bool> >(rows,std::vector<bool>(cols+1,false));
-  horizontal_walls = std::vector<std::vector<bool> >(rows+1,std::vector<bool>(cols,false));
+  memset(vertical_walls, 0, sizeof(vertical_walls));
+  memset(horizontal_walls, 0, sizeof(horizontal_walls));
 
   // initialize the outermost edges of the grid to have walls
   for (int i = 0; i < rows; i++) {
@@ -94,33 +212,121 @@ Board_Threads::Board::Board(int r, int c) {
   for (int i = 0; i < cols; i++) {
     horizontal_walls[0][i] = horizontal_walls[rows][i] = true;
   }
+
+  // splitmix64 from a fixed seed, so every run hashes a state the same way
+  uint64_t seed = 0x52526F626F747321ULL;
+  auto next = [&seed](){
+    uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  };
+  for (int w = 0; w < 26; w++) {
+    for (int r = 0; r < BOARD_MAX_DIM; r++) {
+      for (int c = 0; c < BOARD_MAX_DIM; c++) zobrist[w][r][c] = next();
+    }
+  }
+  for (int d = 0; d < 4; d++) zobrist_dir[d] = next();
 }
 
+// Geometry pass over the finished walls and goals
+void Board_Layout::analyze(int rows, int cols){
+  east_walls.clear();
+  south_walls.clear();
+  for(int r = 0; r < rows; ++r){
+    for(int c = 0; c < cols; ++c){
+      wall_stop[r][c] = vertical_walls[r][c] || vertical_walls[r][c+1] ||
+        horizontal_walls[r][c] || horizontal_walls[r+1][c];
+      if(vertical_walls[r][c+1]) east_walls.add(r, c);
+      if(horizontal_walls[r+1][c]) south_walls.add(r, c);
+    }
+  }
+
+  // breadth first out of each goal: a cell in a wall-free straight line
+  //  from a cell d slides away is at most d+1 slides away
+  goal_dist.clear();
+  goal_needs_blocker.clear();
+  for(unsigned int g = 0; g < goals.size(); ++g){
+    int goal_r = goals[g].pos.row-1, goal_c = goals[g].pos.col-1;
+    std::vector<unsigned char> dist(rows*cols, 0xFF);
+    std::vector<int> queue(1, goal_r*cols + goal_c);
+    dist[queue[0]] = 0;
+    for(unsigned int q = 0; q < queue.size(); ++q){
+      int r0 = queue[q] / cols, c0 = queue[q] % cols;
+      auto reach = [&](int cell){
+        if(dist[cell] != 0xFF) return;
+        dist[cell] = dist[queue[q]] + 1;
+        queue.push_back(cell);
+      };
+      for(int r = r0; !horizontal_walls[r][c0]; --r) reach((r-1)*cols + c0); //north
+      for(int r = r0; !horizontal_walls[r+1][c0]; ++r) reach((r+1)*cols + c0); //south
+      for(int c = c0; !vertical_walls[r0][c]; --c) reach(r0*cols + c-1); //west
+      for(int c = c0; !vertical_walls[r0][c+1]; ++c) reach(r0*cols + c+1); //east
+    }
+    goal_dist.push_back(dist);
+    goal_needs_blocker.push_back(!wall_stop[goal_r][goal_c]);
+  }
+}
 
-Board_Threads::Board_Threads(){}
+Board_Threads::Board::Board(int r, int c) { 
+  // initialize the dimensions
+  rows = r; 
+  cols = c; 
 
-Board_Threads::~Board_Threads(){}
+  // the walls & goals live in a layout shared with every copy
+  layout = std::make_shared<Board_Layout>(rows, cols);
 
+  // every grid cell starts out empty
+  syncCells();
+  ordering = true;
+}
+
+
+Board_Threads::Board_Threads(){
+  core = NULL;
+  show_stats = false;
+  deterministic = false;
+  binary_output = false;
+  puzzle_hash = 0;
+  out = &std::cout;
+}
+
+Board_Threads::~Board_Threads(){
+  delete_copies();
+  delete core;
+}
+
+// Copying a board only copies the flat robot snapshot; the layout is
+// shared and the grid cells are refilled from the robots
 Board_Threads::Board::Board(const Board& old_board){
   rows = old_board.rows;
   cols = old_board.cols;
-  board = old_board.board;
-  vertical_walls = old_board.vertical_walls;
-  horizontal_walls = old_board.horizontal_walls;
+  layout = old_board.layout;
   robots = old_board.robots;
-  goals = old_board.goals;
-  solutions = old_board.solutions;
+  syncCells();
+  ordering = old_board.ordering;
+  // found solutions stay with the board (and arena) that found them
 }
 
 void Board_Threads::Board::operator=(const Board_Threads::Board& old_board){
   rows = old_board.rows;
   cols = old_board.cols;
-  board = old_board.board;
-  vertical_walls = old_board.vertical_walls;
-  horizontal_walls = old_board.horizontal_walls;
+  layout = old_board.layout;
   robots = old_board.robots;
-  goals = old_board.goals;
-  solutions = old_board.solutions;
+  syncCells();
+  ordering = old_board.ordering;
+  // found solutions stay with the board (and arena) that found them
+}
+
+void Board_Threads::Board::syncCells(){
+  memset(board, ' ', sizeof(board));
+  occupied.clear();
+  hash = 0;
+  for (unsigned int i = 0; i < robots.size(); i++) {
+    board[robots[i].pos.row-1][robots[i].pos.col-1] = robots[i].which;
+    occupied.add(robots[i].pos.row-1, robots[i].pos.col-1);
+    hash ^= layout->zobristKey(robots[i].which, robots[i].pos);
+  }
 }
 
 
@@ -130,12 +336,39 @@ bool Board_Threads::usage(const std::string &executable_name) {
   std::cerr << "       " << executable_name << " <puzzle_file> -max_moves <#>" << std::endl;
   std::cerr << "       " << executable_name << " <puzzle_file> -all_solutions" << std::endl;
   std::cerr << "       " << executable_name << " <puzzle_file> -max_moves <#> -all_solutions" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -core" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -bfs [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -time_budget <ms>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above] -stats" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions [-core | -bfs] -format <text | bin>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -count_only [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -external [-ram_budget <MB>] [-temp_dir <dir>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions [-bfs | -count_only | -external] -checkpoint <file> [-checkpoint_every <s>] [-resume]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_targets [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above but -external, -write_table, -table and -verify_hashes] -mem_limit <MB>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> -write_table <file>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] [-all_solutions] -table <file>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above but -stats] -deterministic" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above] -fixed_order" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above] -verify_hashes" << std::endl;
+  std::cerr << "       " << executable_name << " -daemon <socket> [-workers <#>] [-cache <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " -send <socket> <puzzle_file> [-priority <#>] [-max_moves <#>] [-core | -bfs | -count_only] [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " -send <socket> [-stats | -shutdown]" << std::endl;
   exit(0);
 }
 
 void Board_Threads::set_orig_board(const std::string &executable, const std::string &filename){
-  orig_board = load(executable, filename);
-  num_robots = orig_board.getRobots().size();
+  use_board(load(executable, filename), puzzleHash(filename));
+  Sol_Singleton::getInstance()->sizeStates(orig_board.getRows(), orig_board.getCols(), num_robots);
+}
+
+void Board_Threads::use_board(const Board &board, uint64_t hash){
+  orig_board = board;
+  num_robots = orig_board.numRobots();
+  puzzle_hash = hash;
+  // dispatch to the search core compiled for this shape (or the generic one)
+  delete core;
+  core = makeCoreSolver(orig_board);
 }
 
 Board_Threads::Board& Board_Threads::getOrig(){
@@ -143,6 +376,7 @@ Board_Threads::Board& Board_Threads::getOrig(){
 }
 
 void Board_Threads::make_copies(){
+  PROFILE_SCOPE("make_copies");
   int num_threads = num_robots * 5;
   for(int i=0; i < num_threads; ++i){
     Board* new_instance = new Board(orig_board);
@@ -150,6 +384,13 @@ void Board_Threads::make_copies(){
   }
 }
 
+void Board_Threads::delete_copies(){
+  for(unsigned int i = 0; i < thread_boards.size(); ++i){
+    delete thread_boards[i];
+  }
+  thread_boards.clear();
+}
+
 // load a Ricochet Robots puzzle from the input file
 Board_Threads::Board Board_Threads::load(const std::string &executable, const std::string &filename) {
 
@@ -159,13 +400,29 @@ Board_Threads::Board Board_Threads::load(const std::string &executable, const st
     std::cerr << "ERROR: could not open " << filename << " for reading" << std::endl;
     usage(executable);
   }
+  Board_Threads::Board answer;
+  std::string error;
+  if (!parse(istr, answer, error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    exit(0);
+  }
+  return answer;
+}
 
+bool Board_Threads::parse(std::istream &istr, Board &answer, std::string &error) {
   // read in the board dimensions and create an empty board
   // (all outer edges are automatically set to be walls
   int rows,cols;
-  istr >> rows >> cols;
-  assert (rows > 0 && cols > 0);
-  Board_Threads::Board answer(rows,cols);
+  if (!(istr >> rows >> cols) || rows <= 0 || cols <= 0) {
+    error = "the puzzle must start with its rows and columns";
+    return false;
+  }
+  if (rows > BOARD_MAX_DIM || cols > BOARD_MAX_DIM) {
+    error = "boards are limited to " + std::to_string(BOARD_MAX_DIM) + "x" +
+      std::to_string(BOARD_MAX_DIM) + " (rebuild with -DBOARD_MAX_DIM=<n>)";
+    return false;
+  }
+  answer = Board_Threads::Board(rows,cols);
 
   // read in the other characteristics of the puzzle board
   std::string token;
@@ -174,30 +431,42 @@ Board_Threads::Board Board_Threads::load(const std::string &executable, const st
       char a;
       int r,c;
       istr >> a >> r >> c;
-      answer.placeRobot(Position(r,c),a);
+      if (istr && answer.numRobots() == BOARD_MAX_ROBOTS) {
+        error = "boards are limited to " + std::to_string(BOARD_MAX_ROBOTS) +
+          " robots (rebuild with -DBOARD_MAX_ROBOTS=<n>)";
+        return false;
+      }
+      if (istr) error = answer.checkRobot(Position(r,c),a);
+      if (error.empty() && istr) answer.placeRobot(Position(r,c),a);
     } else if (token == "vertical_wall") {
       int i;
       double j;
       istr >> i >> j;
-      answer.addVerticalWall(i,j);
+      if (istr) error = answer.checkVerticalWall(i,j);
+      if (error.empty() && istr) answer.addVerticalWall(i,j);
     } else if (token == "horizontal_wall") {
       double i;
       int j;
       istr >> i >> j;
-      answer.addHorizontalWall(i,j);
+      if (istr) error = answer.checkHorizontalWall(i,j);
+      if (error.empty() && istr) answer.addHorizontalWall(i,j);
     } else if (token == "goal") {
       std::string which_robot;
       int r,c;
       istr >> which_robot >> r >> c;
-      answer.addGoal(which_robot,Position(r,c));
+      if (istr) error = answer.checkGoal(which_robot,Position(r,c));
+      if (error.empty() && istr) answer.addGoal(which_robot,Position(r,c));
     } else {
-      std::cerr << "ERROR: unknown token in the input file " << token << std::endl;
-      exit(0);
+      error = "unknown token in the input file " + token;
+      return false;
     }
+    if (!istr) error = "the " + token + " line is cut short";
+    if (!error.empty()) return false;
   }
 
-  // return the initialized board
-  return answer;
+  // work out the stop cells and goal distances now every wall is in
+  answer.analyzeGeometry();
+  return true;
 }
 
 
@@ -213,7 +482,7 @@ bool Board_Threads::Board::getHorizontalWall(double r, int c) const {
   assert (r >= 0.4 && r <= rows+0.6);
   assert (c >= 1 && c <= cols);
   // subtract one and round down because the corner is (0,0) not (1,1)
-  return horizontal_walls[floor(r)][c-1];
+  return layout->horizontal_walls[(int)floor(r)][c-1];
 }
 
 // Query the existance of a vertical wall
@@ -224,7 +493,7 @@ bool Board_Threads::Board::getVerticalWall(int r, double c) const {
   assert (r >= 1 && r <= rows);
   assert (c >= 0.4 && c <= cols+0.6);
   // subtract one and round down because the corner is (0,0) not (1,1)
-  return vertical_walls[r-1][floor(c)];
+  return layout->vertical_walls[r-1][(int)floor(c)];
 }
 
 
@@ -232,6 +501,46 @@ bool Board_Threads::Board::getVerticalWall(int r, double c) const {
 // MODIFIERS related to board geometry
 // ===================
 
+// The asserts of the modifiers below, as messages
+std::string Board_Threads::Board::checkHorizontalWall(double r, int c) const {
+  if (fabs((r - floor(r))-0.5) >= 0.005 || r < 0 || r > rows || c < 1 || c > cols) {
+    return "a horizontal wall is not between two rows of the board";
+  }
+  if (layout->horizontal_walls[(int)floor(r)][c-1]) return "a horizontal wall is given twice";
+  return "";
+}
+
+std::string Board_Threads::Board::checkVerticalWall(int r, double c) const {
+  if (fabs((c - floor(c))-0.5) >= 0.005 || c < 0 || c > cols || r < 1 || r > rows) {
+    return "a vertical wall is not between two columns of the board";
+  }
+  if (layout->vertical_walls[r-1][(int)floor(c)]) return "a vertical wall is given twice";
+  return "";
+}
+
+std::string Board_Threads::Board::checkRobot(const Position &p, char a) const {
+  if (!isalpha(a) || !isupper(a)) return std::string("robot ") + a + " is not a capital letter";
+  if (p.row < 1 || p.row > rows || p.col < 1 || p.col > cols) return std::string("robot ") + a + " is off the board";
+  if (getspot(p) != ' ') return std::string("robot ") + a + " is on another robot";
+  for (unsigned int i = 0; i < robots.size(); i++) {
+    if (robots[i].which == a) return std::string("robot ") + a + " is given twice";
+  }
+  return "";
+}
+
+std::string Board_Threads::Board::checkGoal(const std::string &gr, const Position &p) const {
+  if (p.row < 1 || p.row > rows || p.col < 1 || p.col > cols) return "goal " + gr + " is off the board";
+  if (gr != "any") {
+    bool robot_exists = false;
+    for (unsigned int i = 0; i < robots.size(); i++) {
+      if (gr.size() == 1 && getRobot(i) == gr[0]) robot_exists = true;
+    }
+    if (!robot_exists) return "goal " + gr + " is not for a robot on the board";
+  }
+  if (isGoal(p) != ' ') return "two goals are on one cell";
+  return "";
+}
+
 // Add an interior horizontal wall
 void Board_Threads::Board::addHorizontalWall(double r, int c) {
   // verify that the requested wall is valid
@@ -240,9 +549,9 @@ void Board_Threads::Board::addHorizontalWall(double r, int c) {
   assert (r >= 0 && r <= rows);
   assert (c >= 1 && c <= cols);
   // verify that the wall does not already exist
-  assert (horizontal_walls[floor(r)][c-1] == false);
+  assert (layout->horizontal_walls[(int)floor(r)][c-1] == false);
   // subtract one and round down because the corner is (0,0) not (1,1)
-  horizontal_walls[floor(r)][c-1] = true;
+  layout->horizontal_walls[(int)floor(r)][c-1] = true;
 }
 
 // Add an interior vertical wall
@@ -253,9 +562,9 @@ void Board_Threads::Board::addVerticalWall(int r, double c) {
   assert (r >= 1 && r <= rows);
   assert (c >= 0 && c <= cols);
   // verify that the wall does not already exist
-  assert (vertical_walls[r-1][floor(c)] == false);
+  assert (layout->vertical_walls[r-1][(int)floor(c)] == false);
   // subtract one and round down because the corner is (0,0) not (1,1)
-  vertical_walls[r-1][floor(c)] = true;
+  layout->vertical_walls[r-1][(int)floor(c)] = true;
 }
 
 
@@ -278,6 +587,9 @@ void Board_Threads::Board::setspot(const Position &p, char a) {
   assert (p.col >= 1 && p.col <= cols);
   // subtract one from each coordinate because the corner is (0,0) not (1,1)
   board[p.row-1][p.col-1] = a;
+  // and keep the row and column masks in step
+  if(a == ' ') occupied.remove(p.row-1, p.col-1);
+  else occupied.add(p.row-1, p.col-1);
 }
 
 char Board_Threads::Board::isGoal(const Position &p) const {
@@ -285,6 +597,7 @@ char Board_Threads::Board::isGoal(const Position &p) const {
   assert (p.row >= 1 && p.row <= rows);
   assert (p.col >= 1 && p.col <= cols);
   // loop over the goals, see if any match this spot
+  const std::vector<Goal>& goals = layout->goals;
   for (unsigned int i = 0; i < goals.size(); i++) {
     if (p == goals[i].pos) { return goals[i].which; }
   }
@@ -318,14 +631,47 @@ void Board_Threads::Board::placeRobot(const Position &p, char a) {
 
   // mark the robot on the board
   setspot(p,a);
+  hash ^= layout->zobristKey(a, p);
 }
 
 // ==================================================================================
 // CHECK GOALS
 // ==================================================================================
 
+// Lower bound from the geometry pass: each goal needs its robot's (or the
+// closest robot's, for '?') slide distance, plus one move of some other
+// robot if the goal needs a blocker and none is beside it yet
+int Board_Threads::Board::movesNeeded() const {
+  const Board_Layout& l = *layout;
+  int most = 0;
+  for(unsigned int g = 0; g < l.goals.size(); ++g){
+    Position goal = l.goals[g].pos;
+    int best = 0xFF;
+    for(unsigned int k = 0; k < robots.size(); ++k){
+      if(l.goals[g].which != '?' && l.goals[g].which != robots[k].which) continue;
+      int d = l.goal_dist[g][(robots[k].pos.row-1)*cols + robots[k].pos.col-1];
+      if(d > 0 && l.goal_needs_blocker[g]){
+        // no walls around the goal, so all four neighbours are on the board
+        bool blocked = false;
+        Position next[4] = { Position(goal.row-1, goal.col), Position(goal.row+1, goal.col),
+                             Position(goal.row, goal.col-1), Position(goal.row, goal.col+1) };
+        for(int n = 0; n < 4; ++n){
+          char who = getspot(next[n]);
+          if(who != ' ' && who != robots[k].which) blocked = true;
+        }
+        if(!blocked) ++d;
+      }
+      best = std::min(best, d);
+    }
+    most = std::max(most, best);
+  }
+  return most;
+}
+
 //Checks if all goals on the board are satisfied or not
 bool Board_Threads::Board::checkGoals(){
+  PROFILE_SCOPE("checkGoals");
+  const std::vector<Goal>& goals = layout->goals;
   for(unsigned int i = 0; i < goals.size(); ++i){
     //char the the position on the 2D board of char's
     char pos = board[(goals[i].pos).row-1][(goals[i].pos).col-1];
@@ -344,6 +690,44 @@ bool Board_Threads::Board::checkGoals(){
   return true;
 }
 
+// ==================================================================================
+// RECORD SOLUTIONS
+// ==================================================================================
+
+//Packs a finished path into this board's arena (one copy, no per-move allocation)
+void Board_Threads::Board::recordSolution(const std::vector<Move>& path){
+  if(found.empty()) stats.first_solution = stats.nodes;
+  if(ordering) order.reward(path);
+  found.push_back(arena.record(path));
+  if(Sol_Singleton::getInstance()->memLimit()) dropLonger(path.size());
+  Sol_Singleton::getInstance()->solutionFound();
+}
+
+//Under -mem_limit: the solutions longer than one of length just found
+//  can't be the shortest, so they go, and once they are most of the
+//  arena the rest are copied into a fresh one
+void Board_Threads::Board::dropLonger(unsigned int length){
+  size_t live = 0, kept = 0;
+  for(unsigned int f = 0; f < found.size(); ++f){
+    if(found[f].size() > length) continue;
+    found[kept++] = found[f];
+    live += found[f].size();
+  }
+  found.resize(kept);
+  if(arena.bytes() <= 2 * live + Sol_Arena::BLOCK_SIZE) return;
+  Sol_Arena packed;
+  for(unsigned int f = 0; f < found.size(); ++f){
+    found[f] = packed.record(found[f].moves, found[f].size());
+  }
+  arena.swap(packed);
+}
+
+//Drops every solution this board found, all blocks at once
+void Board_Threads::Board::releaseSolutions(){
+  found.clear();
+  arena.release();
+}
+
 // ==================================================================================
 // CHECK LAST IN PATH
 // ==================================================================================
@@ -402,6 +786,7 @@ std::string Solution::getKey2(){
 }
 
 std::string Board_Threads::Board::getKey3(){
+  PROFILE_SCOPE("getKey3");
   std::string key = "";
   for(Robot rb : robots){
     key += "w";
@@ -414,6 +799,14 @@ std::string Board_Threads::Board::getKey3(){
   return key;
 };
 
+uint64_t Board_Threads::Board::stateRank(int dir) const {
+  uint64_t rank = 0;
+  for(int k = robots.size() - 1; k >= 0; --k){
+    rank = rank * (rows*cols) + (robots[k].pos.row-1)*cols + (robots[k].pos.col-1);
+  }
+  return rank * 4 + dir;
+}
+
 bool Sol_Singleton::checkState(std::string key, Solution new_sol){
   // check if the current state has ever been reached;
   //  if so, then abort (beacuse another thread must have followed the other paths)
@@ -437,33 +830,181 @@ bool Sol_Singleton::checkState(std::string key, Solution new_sol){
 
 }
 
-bool Sol_Singleton::checkState2(std::string key){
-  // check if the current state has ever been reached;
-  //  if so, then abort (beacuse another thread must have followed the other paths)
-  //std::cout << "in check state" << std::endl;
-  // if the key is not found, then an iterator to the end of the map will be returned
-  //   so, in that case check fails beacuse the state has not been visited before
+void Bounded_States::resize(size_t bytes){
+  size_t n = 1;
+  while(2 * n * sizeof(Bucket) <= bytes) n *= 2;
+  buckets.assign(n, Bucket());
+  clear();
+}
+
+void Bounded_States::clear(){
+  for(size_t b = 0; b < buckets.size(); ++b){
+    memset(buckets[b].move, UNSEEN, sizeof(buckets[b].move));
+  }
+  replaced = 0;
+  dropped = 0;
+}
+
+bool Bounded_States::check(uint64_t hash, int move){
+  Bucket& b = buckets[(size_t)((hash * 0x9E3779B97F4A7C15ULL) >> 32) & (buckets.size() - 1)];
+  int deepest = 0;
+  for(int w = 0; w < STATE_WAYS; ++w){
+    if(b.move[w] == UNSEEN){
+      b.hash[w] = hash;
+      b.move[w] = move;
+      return false;
+    }
+    if(b.hash[w] == hash){
+      if(b.move[w] < move) return true;
+      b.move[w] = move;
+      return false;
+    }
+    if(b.move[w] > b.move[deepest]) deepest = w;
+  }
+  if(b.move[deepest] >= move){
+    b.hash[deepest] = hash;
+    b.move[deepest] = move;
+    ++replaced;
+  }
+  else ++dropped;
+  return false;
+}
+
+//Forgets every state seen, before a new search
+void Sol_Singleton::clearStates(){
+  const std::lock_guard<std::mutex> lock(stateMutex);
+  all_boards.clear();
+  hashed_states.clear();
+  bounded.clear();
+  for(uint64_t r = 0; r < dense_size; ++r){
+    dense_moves[r].store(DENSE_UNSEEN, std::memory_order_relaxed);
+  }
+}
+
+void Sol_Singleton::setVerifyHashes(bool on){
+  verify = on;
+  collisions = 0;
+  if(!verify) return;
+  dense_moves.reset();
+  dense_size = 0;
+}
+
+void Sol_Singleton::sizeStates(int rows, int cols, int robots){
+  if(verify) return; //every state goes through the hashes
+  uint64_t states = 4;
+  for(int k = 0; k < robots && states <= BOARD_DENSE_STATES; ++k) states *= rows*cols;
+  dense_moves.reset();
+  dense_size = 0;
+  bounded = Bounded_States();
+  if(states > BOARD_DENSE_STATES || max_moves > DENSE_MAX_MOVES || (mem_limit && states > mem_limit / 2)){
+    if(mem_limit) bounded.resize(mem_limit / 2);
+    return;
+  }
+  dense_moves.reset(new std::atomic<unsigned char>[states]);
+  dense_size = states;
+  clearStates();
+}
 
-  if( all_boards.count(key) >= 1 ){
+bool Sol_Singleton::checkState2(uint64_t hash, int move, const std::string& state){
+  PROFILE_SCOPE("checkState2");
+  // check if the current state has already been reached in fewer moves;
+  //  if so, then abort (any solution through here has a shorter twin
+  //  through the earlier visit, so none of them can be optimal)
+  // reaching it again in the same number of moves is not enough to abort,
+  //  because every shortest path has to be followed for all_solutions
+
+  // lock up the whole check so that no thread reads the map mid-insert
+  const std::lock_guard<std::mutex> lock(stateMutex);
+  if(verify){
+    std::unordered_map<uint64_t, std::string>::iterator held = hashed_states.find(hash);
+    if(held == hashed_states.end()) hashed_states.insert(std::make_pair(hash, state));
+    else if(held->second != state){
+      // another state has this hash: count it and search on, since its
+      //  depth says nothing about this one
+      ++collisions;
+      return false;
+    }
+  }
+  if(!bounded.empty()) return bounded.check(hash, move);
+  std::unordered_map<uint64_t, int>::iterator itr = all_boards.find(hash);
+  if(itr == all_boards.end()){
+    all_boards.insert(std::make_pair(hash, move));
+    return false;
+  }
+  if(itr->second < move){
     // state is already there, so exit
-    //std::cout << key << std::endl;
-    //print();
     return true;
   }
-  else{
-    // lock up the checkState function so that there are no cache cohenercy issues -> seg fault
-    const std::lock_guard<std::mutex> lock(stateMutex);
-    addBoardToAllBoards(key);
-    return false;
+  itr->second = move;
+  return false;
+}
+
+// A node of the hash map is its pair and a next pointer (and with the
+// states kept, a string and its heap buffer), and a bucket is a pointer
+size_t Sol_Singleton::statesBytes() const {
+  const std::lock_guard<std::mutex> lock(stateMutex);
+  size_t b = dense_size + bounded.bytes();
+  b += all_boards.size() * (sizeof(std::pair<const uint64_t, int>) + sizeof(void*)) +
+    all_boards.bucket_count() * sizeof(void*);
+  for(std::unordered_map<uint64_t, std::string>::const_iterator h = hashed_states.begin();
+      h != hashed_states.end(); ++h){
+    b += sizeof(*h) + sizeof(void*) + h->second.capacity();
   }
+  return b + hashed_states.bucket_count() * sizeof(void*);
+}
 
+bool Sol_Singleton::checkRank(uint64_t rank, int move){
+  PROFILE_SCOPE("checkState2");
+  // same rule as checkState2, with the stored move only ever lowered by a
+  //  compare-and-swap so the threads never wait on each other
+  assert (rank < dense_size && move < DENSE_UNSEEN);
+  unsigned char seen = dense_moves[rank].load(std::memory_order_relaxed);
+  while(seen >= move){
+    if(seen == move) return false;
+    if(dense_moves[rank].compare_exchange_weak(seen, move, std::memory_order_relaxed)) return false;
+  }
+  return true;
+}
+
+// ==================================================================================
+// MOVE ORDERING
+// ==================================================================================
+
+Move_Order::Move_Order(){
+  memset(history, 0, sizeof(history));
+  memset(killer, 0xFF, sizeof(killer)); //no robot has index 63
+}
+
+void Move_Order::reward(const std::vector<Move>& path){
+  for(unsigned int q = 0; q < path.size(); ++q){
+    PackedMove m = packMove(path[q].robot_index, path[q].direction);
+    ++history[m];
+    if(q < KILLER_DEPTHS && killer[q][0] != m){
+      killer[q][1] = killer[q][0];
+      killer[q][0] = m;
+    }
+  }
+}
+
+void Move_Order::sort(Move_Choice* choices, int n, int depth) const {
+  for(int c = 0; c < n; ++c){
+    PackedMove m = choices[c].move;
+    choices[c].killer = 2;
+    if(depth < KILLER_DEPTHS) choices[c].killer = killer[depth][0] == m ? 0 : (killer[depth][1] == m ? 1 : 2);
+    choices[c].history = history[m];
+  }
+  std::stable_sort(choices, choices + n, [](const Move_Choice& a, const Move_Choice& b){
+    if(a.killer != b.killer) return a.killer < b.killer;
+    if(a.needed != b.needed) return a.needed < b.needed;
+    return a.history > b.history;
+  });
 }
 
 // ==================================================================================
 // ONE SOLUTION
 // ==================================================================================
 
-void Board_Threads::Board::one_sol_helper(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_helper(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   bool enableStateCheck=true;
   Robot* curr_robot;
   curr_robot = &robots[i];
@@ -473,263 +1014,145 @@ void Board_Threads::Board::one_sol_helper(int i, int move, int* max_moves, std::
   if(move > *max_moves){
     return;
   }
-  
-  if(checkLast(path, "north", i)){ //Checks the last move to prevent pointless moves
-    //moveRobot fn trys to move robot, returns true if it does move
-    // added by Allan below
-    
-    // added by Allan above
-    if(moveRobot(i, "north")){
-      
-      //Add move to solution
-      Move new_move(i, "north");
-      path.push_back(new_move);
-      
-      //if all goals satisfied, add solution to solutions and return
-      if(checkGoals()){
-        
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
-        path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
-        return;
-      }
-      // added by Allan below
-      if(enableStateCheck){
-        std::string key = getKey3();
-        key += "n";
-        if(Sol_Singleton::getInstance()->checkState2(key)){
-          return;
-        }
-      }
-      one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
-      
-      path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
-      
-    }
+  //Another thread already found the one solution that is needed
+  if(Sol_Singleton::getInstance()->stopRequested()){
+    return;
   }
-  if(checkLast(path, "west", i)){ //Checks the last move to prevent pointless moves
-    // added by Allan below
-    // if(enableStateCheck){
-    //   std::string key = getKey3();
-    //   if(Sol_Singleton::getInstance()->checkState2(key)){
-    //     return;
-    //   }
-    // }
-    // added by Allan above
-    if(moveRobot(i, "west")){
-      //Add move to solution
-      Move new_move(i, "west");
-      path.push_back(new_move);
-      
-      //if all goals satisfied, add solution to solutions and return
-      if(checkGoals()){
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
-        path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
-        return;
-      }
-      // added by Allan below
-      if(enableStateCheck){
-        std::string key = getKey3();
-        key += "w";
-        if(Sol_Singleton::getInstance()->checkState2(key)){
-          return;
-        }
-      }
-      
-      one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
-      
-      path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
-      
-    }
+  //Not even the geometry's best case gets every goal in the moves left
+  if(movesNeeded() > *max_moves - move + 1){
+    return;
   }
-  if(checkLast(path, "south", i)){ //Checks the last move to prevent pointless moves
-    // added by Allan below
-    // if(enableStateCheck){
-    //   std::string key = getKey3();
-    //   if(Sol_Singleton::getInstance()->checkState2(key)){
-    //     return;
-    //   }
-    // }
-    // added by Allan above
-    if(moveRobot(i, "south")){
-      //Add move to solution
-      Move new_move(i, "south");
-      path.push_back(new_move);
-      
-      //if all goals satisfied, add solution to solutions and return
-      if(checkGoals()){
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
-        path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
-        return;
-      }
-      // added by Allan below
-      if(enableStateCheck){
-        std::string key = getKey3();
-        key += "s";
-        if(Sol_Singleton::getInstance()->checkState2(key)){
-          return;
-        }
-      }
-      one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
-      path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
-      
+  ++stats.nodes;
+
+  //Robot i's moves, the most promising first
+  Move_Choice choices[4];
+  int num_choices = orderMoves(i, i+1, path, *max_moves - move, choices);
+  for(int ch = 0; ch < num_choices; ++ch){
+    const std::string& dir = packedDirection(choices[ch].move);
+    if(!makeMove(choices[ch])) continue;
+
+    //Add move to solution
+    Move new_move(i, dir);
+    path.push_back(new_move);
+
+    //if all goals satisfied, add solution to solutions (another of robot
+    //  i's moves from here could tie it, so the rest are still tried)
+    if(checkGoals()){
+      recordSolution(path);
+      tightenMaxMoves(max_moves, move); //only ever lowers max_moves
     }
-  }
-  if(checkLast(path, "east", i)){ //Checks the last move to prevent pointless moves
-    // added by Allan below
-    // if(enableStateCheck){
-    //   std::string key = getKey3();
-    //   if(Sol_Singleton::getInstance()->checkState2(key)){
-    //     return;
-    //   }
-    // }
-    // added by Allan above
-    if(moveRobot(i, "east")){
-      //Add move to solution
-      Move new_move(i, "east");
-      path.push_back(new_move);
-      
-      //if all goals satisfied, add solution to solutions and return
-      if(checkGoals()){
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
-        path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
-        return;
-      }
-      
-      // added by Allan below
+    else{
+      bool seen = false;
       if(enableStateCheck){
-        std::string key = getKey3();
-        key += "e";
-        if(Sol_Singleton::getInstance()->checkState2(key)){
-          return;
+        Sol_Singleton* shared = Sol_Singleton::getInstance();
+        if(shared->denseStates()){
+          seen = shared->checkRank(stateRank(choices[ch].move & 3), move);
         }
+        else if(shared->verifyHashes()){
+          std::string key = getKey3();
+          key += dir[0];
+          seen = shared->checkState2(stateHash(choices[ch].move & 3), move, key);
+        }
+        else seen = shared->checkState2(stateHash(choices[ch].move & 3), move, std::string());
+        if(seen) ++stats.dedup_hits;
       }
-      one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
-      path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
-      
+      if(!seen) one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
     }
+
+    path.pop_back();//deletes the last move before moving on and trying the next one
+    undoMove(curr_robot, orig_pos); //resets the board to how it was
   }
-  // added by Allan below
-  // if(enableStateCheck){
-  //   std::string key = getKey3();
-  //   if(Sol_Singleton::getInstance()->checkState2(key)){
-  //     return;
-  //   }
-  // }
 }
 
-void Board_Threads::Board::one_sol_helper_other(int i, int move, int* max_moves,
+void Board_Threads::Board::one_sol_helper_other(int i, int move, std::atomic<int>* max_moves,
     std::vector<Move>& path){
   //If move is greater than max_moves, end recursion step
   if(move > *max_moves-1){
     return;
   }
-
-  for(unsigned int l = 0; l < robots.size(); ++l){
+  if(Sol_Singleton::getInstance()->stopRequested()){
+    return;
+  }
+  if(movesNeeded() > *max_moves - move + 1){
+    return;
+  }
+  ++stats.nodes;
+
+  //Every robot's moves, the most promising first
+  Move_Choice choices[4*BOARD_MAX_ROBOTS];
+  int num_choices = orderMoves(0, robots.size(), path, *max_moves - move, choices);
+  for(int ch = 0; ch < num_choices; ++ch){
+    int l = packedRobot(choices[ch].move);
+    const std::string& dir = packedDirection(choices[ch].move);
     Robot* other_robot;
     other_robot = &robots[l];
     Position orig_pos = other_robot->pos;
 
-    if(checkLast(path, "north", l)){ //Checks the last move to prevent pointless moves
-      //moveRobot fn trys to move robot, returns true if it does move
-      if(moveRobot(l, "north")){
-        //Add move to solution
-        Move new_move(l, "north");
-        path.push_back(new_move);
+    if(!makeMove(choices[ch])) continue;
 
-        //if statement cuts out duplicate solutions + increases efficiency
-        if(l != (unsigned int)i) one_sol_helper(i, move+1, max_moves, path);
-        one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
+    //Add move to solution
+    Move new_move(l, dir);
+    path.push_back(new_move);
 
-        path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
-      }
-    }
-    if(checkLast(path, "west", l)){ //Checks the last move to prevent pointless moves
-      if(moveRobot(l, "west")){
-        //Add move to solution
-        Move new_move(l, "west");
-        path.push_back(new_move);
-        
-        //if statement cuts out duplicate solutions + increases efficiency
-        if(l != (unsigned int)i) one_sol_helper(i, move+1, max_moves, path);
-        one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
+    //if statement cuts out duplicate solutions + increases efficiency
+    if(l != i) one_sol_helper(i, move+1, max_moves, path);
+    one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
 
-        path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
-      }
-    }
-    if(checkLast(path, "south", l)){ //Checks the last move to prevent pointless moves
-      if(moveRobot(l, "south")){
-        //Add move to solution
-        Move new_move(l, "south");
-        path.push_back(new_move);
-        
-        //if statement cuts out duplicate solutions + increases efficiency
-        if(l != (unsigned int)i) one_sol_helper(i, move+1, max_moves, path);
-        one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
+    path.pop_back(); //deletes last move
+    undoMove(other_robot, orig_pos); //resets the board to how it was
+  }
+}
 
-        path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
-      }
-    }
-    if(checkLast(path, "east", l)){ //Checks the last move to prevent pointless moves
-      if(moveRobot(l, "east")){
-        //Add move to solution
-        Move new_move(l, "east");
-        path.push_back(new_move);
-        
-        //if statement cuts out duplicate solutions + increases efficiency
-        if(l != (unsigned int)i) one_sol_helper(i, move+1, max_moves, path);
-        one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
-
-        path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
+//Fills choices with the moves of robots first..last-1 that checkLast
+//  allows, each robot's in the order north, west, south, east.  With
+//  ordering on, each one is made and undone to score it, the ones that go
+//  nowhere or need more than moves_left after them are dropped (the child
+//  would cut itself off on the same movesNeeded() check) and the rest are
+//  sorted by Move_Order
+int Board_Threads::Board::orderMoves(int first, int last, std::vector<Move>& path,
+    int moves_left, Move_Choice* choices){
+  static const char* fixed_dirs[4] = {"north", "west", "south", "east"};
+  int num_choices = 0;
+  for(int l = first; l < last; ++l){
+    Robot* robot = &robots[l];
+    Position orig_pos = robot->pos;
+    for(int d = 0; d < 4; ++d){
+      if(!checkLast(path, fixed_dirs[d], l)) continue;
+      Move_Choice& choice = choices[num_choices];
+      choice.move = packMove(l, fixed_dirs[d]);
+      choice.needed = 0;
+      if(ordering){
+        if(!moveRobot(l, fixed_dirs[d])) continue;
+        choice.needed = movesNeeded();
+        choice.to = robot->pos;
+        undoMove(robot, orig_pos);
+        if(choice.needed > moves_left) continue;
       }
+      ++num_choices;
     }
   }
+  if(ordering) order.sort(choices, num_choices, path.size());
+  return num_choices;
+}
+
+//Plays a move from orderMoves, false if the robot cannot move that way
+bool Board_Threads::Board::makeMove(const Move_Choice& choice){
+  int l = packedRobot(choice.move);
+  if(!ordering) return moveRobot(l, packedDirection(choice.move));
+  //ordering already slid the robot once, so put it straight where it stopped
+  undoMove(&robots[l], choice.to);
+  return true;
 }
 
-void Board_Threads::Board::one_sol_north(int i, int move, int* max_moves, std::vector<Move>& path){
+//Moves robot straight to orig_pos, the board cells and hash with it
+void Board_Threads::Board::undoMove(Robot* robot, const Position& orig_pos){
+  setspot(robot->pos, ' ');
+  hash ^= layout->zobristKey(robot->which, robot->pos) ^ layout->zobristKey(robot->which, orig_pos);
+  robot->pos = orig_pos;
+  setspot(robot->pos, robot->which);
+}
+
+void Board_Threads::Board::one_sol_north(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   Robot* curr_robot;
   curr_robot = &robots[i];
   Position orig_pos = curr_robot->pos;
@@ -746,26 +1169,21 @@ void Board_Threads::Board::one_sol_north(int i, int move, int* max_moves, std::v
       path.push_back(new_move);
       //if all goals satisfied, add solution to solutions and return
       if(checkGoals()){
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
+        recordSolution(path);
+        tightenMaxMoves(max_moves, move); //only ever lowers max_moves
         path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
+        undoMove(curr_robot, orig_pos); //resets the board to how it was
         return;
       }
       one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
 
       path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
+      undoMove(curr_robot, orig_pos); //resets the board to how it was
     }
   }
 }
 
-void Board_Threads::Board::one_sol_east(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_east(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   Robot* curr_robot;
   curr_robot = &robots[i];
   Position orig_pos = curr_robot->pos;
@@ -782,26 +1200,21 @@ void Board_Threads::Board::one_sol_east(int i, int move, int* max_moves, std::ve
       path.push_back(new_move);
       //if all goals satisfied, add solution to solutions and return
       if(checkGoals()){
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
+        recordSolution(path);
+        tightenMaxMoves(max_moves, move); //only ever lowers max_moves
         path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
+        undoMove(curr_robot, orig_pos); //resets the board to how it was
         return;
       }
       one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
 
       path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
+      undoMove(curr_robot, orig_pos); //resets the board to how it was
     }
   }
 }
 
-void Board_Threads::Board::one_sol_west(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_west(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   Robot* curr_robot;
   curr_robot = &robots[i];
   Position orig_pos = curr_robot->pos;
@@ -818,26 +1231,21 @@ void Board_Threads::Board::one_sol_west(int i, int move, int* max_moves, std::ve
       path.push_back(new_move);
       //if all goals satisfied, add solution to solutions and return
       if(checkGoals()){
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
+        recordSolution(path);
+        tightenMaxMoves(max_moves, move); //only ever lowers max_moves
         path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
+        undoMove(curr_robot, orig_pos); //resets the board to how it was
         return;
       }
       one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
 
       path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
+      undoMove(curr_robot, orig_pos); //resets the board to how it was
     }
   }
 }
 
-void Board_Threads::Board::one_sol_south(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_south(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   Robot* curr_robot;
   curr_robot = &robots[i];
   Position orig_pos = curr_robot->pos;
@@ -854,26 +1262,21 @@ void Board_Threads::Board::one_sol_south(int i, int move, int* max_moves, std::v
       path.push_back(new_move);
       //if all goals satisfied, add solution to solutions and return
       if(checkGoals()){
-        Solution new_sol(path);
-        Sol_Singleton::getInstance()->addState(new_sol.getKey(), new_sol);
-        *max_moves = move; //resets max_moves
+        recordSolution(path);
+        tightenMaxMoves(max_moves, move); //only ever lowers max_moves
         path.pop_back();//deletes the last move before moving on and trying the next one
-        setspot(curr_robot->pos, ' '); //resets the board to how it was
-        curr_robot->pos = orig_pos;
-        setspot(curr_robot->pos, curr_robot->which);
+        undoMove(curr_robot, orig_pos); //resets the board to how it was
         return;
       }
       one_sol_helper(i, move+1, max_moves, path); //recursive call (increment move)
 
       path.pop_back();//deletes the last move before moving on and trying the next one
-      setspot(curr_robot->pos, ' '); //resets the board to how it was
-      curr_robot->pos = orig_pos;
-      setspot(curr_robot->pos, curr_robot->which);
+      undoMove(curr_robot, orig_pos); //resets the board to how it was
     }
   }
 }
 
-void Board_Threads::Board::one_sol_other_north(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_other_north(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   //If move is greater than max_moves, end recursion step
   if(move > *max_moves-1){
     return;
@@ -896,15 +1299,13 @@ void Board_Threads::Board::one_sol_other_north(int i, int move, int* max_moves,
         one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
 
         path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
+        undoMove(other_robot, orig_pos); //resets the board to how it was
       }
     }
   }
 }
 
-void Board_Threads::Board::one_sol_other_east(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_other_east(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   //If move is greater than max_moves, end recursion step
   if(move > *max_moves-1){
     return;
@@ -927,15 +1328,13 @@ void Board_Threads::Board::one_sol_other_east(int i, int move, int* max_moves, s
         one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
 
         path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
+        undoMove(other_robot, orig_pos); //resets the board to how it was
       }
     }
   }
 }
 
-void Board_Threads::Board::one_sol_other_west(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_other_west(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   //If move is greater than max_moves, end recursion step
   if(move > *max_moves-1){
     return;
@@ -958,15 +1357,13 @@ void Board_Threads::Board::one_sol_other_west(int i, int move, int* max_moves, s
         one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
 
         path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
+        undoMove(other_robot, orig_pos); //resets the board to how it was
       }
     }
   }
 }
 
-void Board_Threads::Board::one_sol_other_south(int i, int move, int* max_moves, std::vector<Move>& path){
+void Board_Threads::Board::one_sol_other_south(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path){
   //If move is greater than max_moves, end recursion step
   if(move > *max_moves-1){
     return;
@@ -989,9 +1386,7 @@ void Board_Threads::Board::one_sol_other_south(int i, int move, int* max_moves,
         one_sol_helper_other(i, move+1, max_moves, path); //recursive call (move+1)
 
         path.pop_back(); //deletes last move
-        setspot(other_robot->pos, ' '); //resets the board to how it was
-        other_robot->pos = orig_pos;
-        setspot(other_robot->pos, other_robot->which);
+        undoMove(other_robot, orig_pos); //resets the board to how it was
       }
     }
   }
@@ -1007,98 +1402,225 @@ bool sortSolutions(const Solution& a, const Solution& b){
   return aSize < bSize;
 }
 
-// void Board_Threads::one_solution(int max_movs, bool moves_given){
-//   std::vector<Move> path; //creates path of moves
-//   int* max_moves = new int; //max_moves made into dynamic memory
-//   *max_moves = max_movs;
-//   int move;
-//   for(unsigned int i = 0; i < num_robots; ++i){
-//     if(checkGoals()){ //checks if the board is already solved
-//       std::vector<Move> blank_path;
-//       blank_path.push_back(Move(-1, "zero_length")); //special case solution
-//       Solution new_sol(blank_path);
-//       solutions.push_back(new_sol);
-//       break;
-//     }
-
-//     if(*max_moves == 0) continue; //special case
-//     move = 1;
-//     one_sol_helper(i, move, max_moves, path); //case where only one robot moves
-//     one_sol_helper_other(i, move, max_moves, path); //all robots can move
-//   }
-//   if(solutions.size() == 0 && moves_given){ //max_moves given
-//     std::cout << "no solutions with " << *max_moves << " or fewer moves" << std::endl;
-//   }
-//   else if(solutions.size() == 0 && !moves_given){ //all_solutions case
-//     std::cout << "no solutions" << std::endl;
-//   }
-//   else{
-//     //Sort the solutions (shortest solutions first)
-//     std::sort(solutions.begin(), solutions.end(), sortSolutions);
-
-//     std::vector<Move> one_sol = solutions[0].path;
-//     for(unsigned int q = 0; q < one_sol.size(); ++q){
-//       int bot_index = one_sol[q].robot_index; //finds all of the necessary variables
-//       std::string bot_dir = one_sol[q].direction;
-//       char bot_char = robots[bot_index].which;
-
-//       moveRobot(bot_index, bot_dir); //makes next move + prints out move
-//       std::cout << "robot " << bot_char << " moves " << bot_dir << std::endl;
-
-//       print(); //prints out the board
-//     }
-//     std::cout << "All goals are satisfied after " << one_sol.size() << 
-//       " moves" << std::endl; //prints out the number of moves used
-//   }
-//   delete max_moves; //cleans up dynamic memory
-// }
+// Iterative deepening over the threaded search: a pass with limit d only
+// runs once every shallower limit came up empty, so the first solution any
+// thread records is a shortest one and every other thread is told to stop
+void Board_Threads::one_solution(int max_movs, bool moves_given){
+  if(orig_board.checkGoals()){ //checks if the board is already solved
+    std::cout << "All goals are satisfied after 0 moves" << std::endl;
+    return;
+  }
+
+  Sol_Singleton* shared = Sol_Singleton::getInstance();
+  shared->setStopOnSolution(true);
+  std::vector<Sol_Span> solutions;
+  std::atomic<int>* max_moves = new std::atomic<int>; //max_moves made into dynamic memory
+  for(int limit = 1; limit <= max_movs && solutions.empty(); ++limit){
+    *max_moves = limit;
+    shared->clearStates(); //states seen are only good for one limit
+    search_threads(max_moves);
+    if(deterministic && shared->stopRequested()){
+      //Which solutions got recorded before the threads stopped is down to
+      //  timing, so run this limit again to the end for all of them
+      shared->setStopOnSolution(false);
+      *max_moves = limit;
+      shared->clearStates();
+      search_threads(max_moves);
+    }
+    for(unsigned int b = 0; b < thread_boards.size(); ++b){
+      const std::vector<Sol_Span>& found = thread_boards[b]->getFound();
+      solutions.insert(solutions.end(), found.begin(), found.end());
+    }
+  }
+  shared->setStopOnSolution(false);
+  delete max_moves; //cleans up dynamic memory
+
+  if(solutions.size() == 0 && moves_given){ //max_moves given
+    std::cout << "no solutions with " << max_movs << " or fewer moves" << std::endl;
+  }
+  else if(solutions.size() == 0 && !moves_given){ //all_solutions case
+    std::cout << "no solutions" << std::endl;
+  }
+  else{
+    //More than one thread may have finished a solution before stopping,
+    //  so print the first one in getKey() order (with -deterministic,
+    //  the first of all the shortest ones)
+    print_one_solution(*std::min_element(solutions.begin(), solutions.end()));
+  }
+  delete_copies(); //the spans are gone with the boards' arenas
+}
+
+//Plays one solution on a copy of the original board, printing each move
+//  and the board after it
+void Board_Threads::print_one_solution(const Sol_Span& one_sol){
+  Board board(orig_board);
+  for(unsigned int q = 0; q < one_sol.size(); ++q){
+    int bot_index = packedRobot(one_sol[q]); //finds all of the necessary variables
+    std::string bot_dir = packedDirection(one_sol[q]);
+    char bot_char = board.getRobot(bot_index);
+
+    board.moveRobot(bot_index, bot_dir); //makes next move + prints out move
+    std::cout << "robot " << bot_char << " moves " << bot_dir << std::endl;
+
+    board.print(); //prints out the board
+  }
+  std::cout << "All goals are satisfied after " << one_sol.size() << 
+    " moves" << std::endl; //prints out the number of moves used
+}
+
+// One solution within a time budget: the core's greedy pass reports an
+// upper bound within milliseconds, and it or the branch and bound after it
+// tightens that until the best one is proven optimal or budget_ms runs out
+void Board_Threads::anytime_solution(int max_movs, bool moves_given, int budget_ms){
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Sol_Arena arena;
+  Sol_Span best;
+  bool any = false;
+  auto improved = [&](const Sol_Span& sol){
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "  best so far: " << sol.size() << " moves after " << elapsed.count() << " ms" << std::endl;
+    best = sol;
+    any = true;
+  };
+  bool proven = core->best_solution(max_movs, start + std::chrono::milliseconds(budget_ms),
+    arena, improved);
+
+  if(!any && !proven){
+    std::cout << "no solution found within " << budget_ms << " ms" << std::endl;
+  }
+  else if(!any && moves_given){ //max_moves given
+    std::cout << "no solutions with " << max_movs << " or fewer moves" << std::endl;
+  }
+  else if(!any){
+    std::cout << "no solutions" << std::endl;
+  }
+  else{
+    print_one_solution(best);
+    if(proven) std::cout << "this solution is optimal" << std::endl;
+    else std::cout << "this solution is not proven optimal (the " << budget_ms <<
+      " ms budget ran out)" << std::endl;
+  }
+}
 
 
 // ==================================================================================
 // ALL SOLUTIONS
 // ==================================================================================
 
+//Prints the count and then every one of the shortest solutions in solutions
+void Board_Threads::print_solutions(std::vector<Sol_Span>& solutions, int max_moves, bool moves_given){
+  //Sort in getKey() order with the duplicates (the same path found by two
+  //  threads) removed
+  std::sort(solutions.begin(), solutions.end());
+  solutions.erase(std::unique(solutions.begin(), solutions.end()), solutions.end());
+
+  //Find the smallest length solution and the number of ties for it
+  unsigned int prev_len = solutions.empty() ? 0 : solutions[0].size();
+  unsigned int num_solutions = 0;
+  for(unsigned int index = 0; index < solutions.size(); ++index){
+    if(solutions[index].size() < prev_len){
+      prev_len = solutions[index].size();
+      num_solutions = 0;
+    }
+    if(solutions[index].size() == prev_len) ++num_solutions;
+  }
 
-void Board_Threads::all_solutions(int max_movs, bool moves_given){
+  if(binary_output){ //-format bin, see sol_format.h (render_solutions prints the text)
+    Sol_Bin_Header header;
+    header.puzzle_hash = puzzle_hash;
+    header.moves_given = moves_given;
+    header.max_moves = max_moves;
+    for(unsigned int i = 0; i < orig_board.numRobots(); ++i) header.robots += orig_board.getRobot(i);
+    header.length = prev_len;
+    header.count = num_solutions;
+    writeSolHeader(*out, header);
+    for(unsigned int index = 0; index < solutions.size(); ++index){
+      if(solutions[index].size() != prev_len) continue;
+      out->write((const char*)solutions[index].moves, prev_len);
+    }
+    out->flush();
+  }
+  else if(solutions.size() == 0 && moves_given){ //no solutions found and max_moves given
+    *out << "no solutions with " << max_moves << " or fewer moves" << std::endl;
+  }
+  else if(solutions.size() == 0 && !moves_given){ //no solutions and max_moves not given
+    *out << "no solutions" << std::endl;
+  }
+  else{
+    //Print out total number of solutions
+    *out << num_solutions << " different " << prev_len <<
+      " move solutions:" << std::endl << std::endl;
+
+    //Go through each of the shortest solutions and print them out
+    for(unsigned int index = 0; index < solutions.size(); ++index){
+      const Sol_Span& one_solu = solutions[index]; //single solution
+      if(one_solu.size() != prev_len) continue;
+      for(unsigned int q = 0; q < one_solu.size(); ++q){
+        char bot_char = orig_board.getRobot(packedRobot(one_solu[q]));
+
+        //Print out each move
+        *out << "robot " << bot_char << " moves " << packedDirection(one_solu[q]) << std::endl;
+      }
+      //Print out the number of moves to solve the board
+      *out << "All goals are satisfied after " << one_solu.size() << 
+        " moves" << std::endl << std::endl;
+    }
+  }
+
+}
+
+
+//Searches with one_sol_helper and the four one_sol_other_* roots for every
+//robot, each in its own thread on its own copy of the original board
+void Board_Threads::search_threads(std::atomic<int>* max_moves){
   std::vector<Move> path; //creates path of moves
   int move;
-  int* max_moves = new int; //makes max_moves dynamic memory
-  *max_moves = max_movs;
+  delete_copies(); // Boards (and solutions) left over from an earlier search
   make_copies(); // Make the copies of the original board for the threads
 
-  auto one_sol = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  auto one_sol = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
+    PROFILE_SCOPE("one_sol_helper");
+    Stats_Timer timer(board->getStats(), "one_sol_helper", robot_ind);
     board->Board::one_sol_helper(robot_ind, move, max_moves, path);
   };
 
-  // auto one_sol_north = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  // auto one_sol_north = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
   //   board->Board::one_sol_north(robot_ind, move, max_moves, path);
   // };
 
-  // auto one_sol_east = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  // auto one_sol_east = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
   //   board->Board::one_sol_east(robot_ind, move, max_moves, path);
   // };
 
-  // auto one_sol_west = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  // auto one_sol_west = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
   //   board->Board::one_sol_west(robot_ind, move, max_moves, path);
   // };
 
-  // auto one_sol_south = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  // auto one_sol_south = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
   //   board->Board::one_sol_south(robot_ind, move, max_moves, path);
   // };
 
-  auto one_sol_other_north = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  auto one_sol_other_north = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
+    PROFILE_SCOPE("one_sol_other_north");
+    Stats_Timer timer(board->getStats(), "one_sol_other_north", robot_ind);
     board->Board::one_sol_other_north(robot_ind, move, max_moves, path);
   };
 
-  auto one_sol_other_east = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  auto one_sol_other_east = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
+    PROFILE_SCOPE("one_sol_other_east");
+    Stats_Timer timer(board->getStats(), "one_sol_other_east", robot_ind);
     board->Board::one_sol_other_east(robot_ind, move, max_moves, path);
   };
 
-  auto one_sol_other_west = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  auto one_sol_other_west = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
+    PROFILE_SCOPE("one_sol_other_west");
+    Stats_Timer timer(board->getStats(), "one_sol_other_west", robot_ind);
     board->Board::one_sol_other_west(robot_ind, move, max_moves, path);
   };
 
-  auto one_sol_other_south = [&](Board* board, int robot_ind, int move, int* max_moves, std::vector<Move> path){
+  auto one_sol_other_south = [&](Board* board, int robot_ind, int move, std::atomic<int>* max_moves, std::vector<Move> path){
+    PROFILE_SCOPE("one_sol_other_south");
+    Stats_Timer timer(board->getStats(), "one_sol_other_south", robot_ind);
     board->Board::one_sol_other_south(robot_ind, move, max_moves, path);
   };
 
@@ -1107,6 +1629,7 @@ void Board_Threads::all_solutions(int max_movs, bool moves_given){
 
     if(*max_moves == 0) continue; //special case
     move = 1;
+    PROFILE_SCOPE("spawn threads");
     
     threads.push_back(std::thread(one_sol, thread_boards[5*i], i, move, max_moves, path));
     // threads.push_back(std::thread(one_sol_other, thread_boards[2*i+1], i, move, max_moves, path));
@@ -1120,62 +1643,328 @@ void Board_Threads::all_solutions(int max_movs, bool moves_given){
     threads.push_back(std::thread(one_sol_other_south, thread_boards[5*i+4], i, move, max_moves, path));
   }
   for(std::thread & th : threads){
+    PROFILE_SCOPE("join threads");
     if(th.joinable())
       th.join();
   }
+  threads.clear();
+  if(show_stats) print_stats();
+}
 
-  std::map<std::string, Solution>& solutions_map = Sol_Singleton::getInstance()->getSolutions();
-  if(solutions_map.size() == 0 && moves_given){ //no solutions found and max_moves given
-    std::cout << "no solutions with " << *max_moves << " or fewer moves" << std::endl;
+// The most RAM the process has held at once (Linux gives ru_maxrss in KB)
+static long peakResidentMB(){
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024;
+}
+
+//One line per thread about the subtree it searched (with the nodes it
+//  had searched when it found its first solution), then the nodes of
+//  every thread and how uneven the work was: the busiest thread's CPU
+//  time over the mean (1 is even)
+void Board_Threads::print_stats(){
+  std::cout << "thread stats:" << std::endl;
+  std::cout << "  thread  task                 robot   wall ms    cpu ms       nodes"
+    << "  solutions  dedup hits   first sol" << std::endl;
+  double most = 0, total = 0;
+  unsigned long all_nodes = 0;
+  int ran = 0;
+  for(unsigned int b = 0; b < thread_boards.size(); ++b){
+    const Search_Stats& st = thread_boards[b]->getStats();
+    if(st.task == "") continue; //never started (max_moves of 0)
+    std::cout << std::fixed << std::setprecision(2)
+      << "  " << std::setw(6) << b << "  " << std::left << std::setw(20) << st.task << std::right
+      << std::setw(6) << orig_board.getRobot(st.robot)
+      << std::setw(10) << st.wall_ms << std::setw(10) << st.cpu_ms
+      << std::setw(12) << st.nodes << std::setw(11) << thread_boards[b]->getFound().size()
+      << std::setw(12) << st.dedup_hits;
+    if(st.first_solution > 0) std::cout << std::setw(12) << st.first_solution << std::endl;
+    else std::cout << std::setw(12) << "-" << std::endl;
+    all_nodes += st.nodes;
+    most = std::max(most, st.cpu_ms);
+    total += st.cpu_ms;
+    ++ran;
   }
-  else if(solutions_map.size() == 0 && !moves_given){ //no solutions and max_moves not given
-    std::cout << "no solutions" << std::endl;
+  std::cout << "  nodes in all threads: " << all_nodes << std::endl;
+  if(ran > 0 && total > 0){
+    std::cout << "  imbalance (max / mean cpu time): " << most / (total / ran) << std::endl;
   }
-  else{
-    std::map<std::string, Solution>::iterator itr = solutions_map.begin();
-    std::vector<Solution> solutions;
-    for(; itr != solutions_map.end(); ++itr){
-      solutions.push_back(itr->second);
-    }
-    //Sort the solutions (shortest solutions first)
-    std::sort(solutions.begin(), solutions.end(), sortSolutions);
+  // what is held now, not counting the board copies and stacks
+  Sol_Singleton* shared = Sol_Singleton::getInstance();
+  size_t solution_bytes = 0;
+  for(unsigned int b = 0; b < thread_boards.size(); ++b){
+    solution_bytes += thread_boards[b]->solutionBytes();
+  }
+  std::cout << "  memory: " << shared->statesBytes() / (1 << 20) << " MB states table, "
+    << solution_bytes / 1024 << " KB solutions, " << peakResidentMB() << " MB peak resident";
+  if(shared->memLimit()){
+    std::cout << " (limit " << shared->memLimit() / (1 << 20) << " MB: " << shared->statesReplaced()
+      << " states replaced, " << shared->statesDropped() << " not kept)";
+  }
+  std::cout << std::endl;
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+}
 
-    unsigned int index = 0;
-    unsigned int prev_len = solutions[index].path.size(); //smallest length solution
-    unsigned int num_solutions = 0;
+// The same for a breadth first search of the core: how big its states
+// and keys are at this board's size tier, what the visited table took
+// per state and how fast states were claimed
+void Board_Threads::print_core_stats(double seconds){
+  Core_Stats st = core->stats();
+  std::cout << "core stats (" << core->name() << "):" << std::endl;
+  std::cout << "  states: " << st.states << "  expanded: " << st.expanded << std::endl;
+  std::cout << "  bytes: " << st.key_bytes << " per key, " << st.state_bytes
+    << " per frontier state, ";
+  if(st.states > 0) std::cout << std::fixed << std::setprecision(1)
+    << (double)st.table_bytes / st.states << " per visited state";
+  else std::cout << "- per visited state";
+  std::cout << " (" << st.table_bytes / (1 << 20) << " MB table)" << std::endl;
+  if(st.runs > 0){
+    std::cout << "  disk: " << st.runs << " sorted runs, " << st.disk_written / (1 << 20)
+      << " MB written, " << st.disk_read / (1 << 20) << " MB read" << std::endl;
+  }
+  if(st.checkpoints > 0 || st.resumed_depth >= 0){
+    std::cout << "  checkpoints: " << st.checkpoints << " written, the last "
+      << st.checkpoint_bytes / (1 << 20) << " MB";
+    if(st.resumed_depth >= 0) std::cout << ", resumed after level " << st.resumed_depth;
+    std::cout << std::endl;
+  }
+  std::cout << "  memory: " << peakResidentMB() << " MB peak resident";
+  if(st.mem_limit > 0){
+    std::cout << " (limit " << st.mem_limit / (1 << 20) << " MB";
+    if(st.replaced > 0 || st.dropped > 0){
+      std::cout << ": " << st.replaced << " states replaced, " << st.dropped << " not kept";
+    }
+    std::cout << ")";
+  }
+  std::cout << std::endl;
+  std::cout << std::fixed << std::setprecision(0);
+  if(seconds > 0) std::cout << "  states per second: " << st.states / seconds
+    << "  expanded per second: " << st.expanded / seconds << std::endl;
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+}
 
-    //Find the number of solutions (number of ties, if there are any)
-    while(solutions[index].path.size() == prev_len){
-      ++num_solutions; //increment number of solutions
-      ++index; //increment index to the next solution
+void Board_Threads::all_solutions(int max_movs, bool moves_given){
+  if(orig_board.checkGoals()){ //already solved, the one 0 move solution
+    Sol_Arena arena;
+    std::vector<Sol_Span> solutions(1, arena.record(NULL, 0));
+    print_solutions(solutions, max_movs, moves_given);
+    return;
+  }
+  std::atomic<int>* max_moves = new std::atomic<int>; //makes max_moves dynamic memory
+  *max_moves = max_movs;
+  search_threads(max_moves);
+
+  //Gather the spans every thread found and print the shortest ones.  The
+  //  bound ends at the shortest length any thread found, so the longer
+  //  ones recorded before it came down are left out here, and what is
+  //  printed does not depend on which thread got where first
+  std::vector<Sol_Span> solutions;
+  for(unsigned int b = 0; b < thread_boards.size(); ++b){
+    const std::vector<Sol_Span>& found = thread_boards[b]->getFound();
+    for(unsigned int f = 0; f < found.size(); ++f){
+      if((int)found[f].size() == *max_moves) solutions.push_back(found[f]);
     }
+  }
+  print_solutions(solutions, max_movs, moves_given);
 
-    //Print out total number of solutions
-    std::cout << num_solutions << " different " << prev_len <<
-      " move solutions:" << std::endl << std::endl;
+  //The spans are gone with the arenas, so release every thread's solutions at once
+  for(unsigned int b = 0; b < thread_boards.size(); ++b){
+    thread_boards[b]->releaseSolutions();
+  }
+  delete max_moves; //cleans up dynamic memory
+}
 
-    index = 0; //resets index to beginning of solutions
-    //Go through each of the shortest solutions and print them out
-    std::vector<Robot>& robots = orig_board.getRobots();
-    while(index < num_solutions){
-      std::vector<Move> one_solu = solutions[index].path; //single solution
-      for(unsigned int q = 0; q < one_solu.size(); ++q){
-        int bot_index = one_solu[q].robot_index;
-        std::string bot_dir = one_solu[q].direction;
-        char bot_char = robots[bot_index].which;
+// Same output as all_solutions, but searched by the packed core that was
+// specialized on this board's dimensions and number of robots
+void Board_Threads::core_solutions(int max_movs, bool moves_given){
+  Sol_Arena arena;
+  std::vector<Sol_Span> solutions;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  core->all_solutions(max_movs, arena, solutions);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  print_solutions(solutions, max_movs, moves_given);
+  if(show_stats) print_core_stats(elapsed.count());
+}
 
-        //Print out each move
-        std::cout << "robot " << bot_char << " moves " << bot_dir << std::endl;
+// Same again, by a level-synchronous breadth first search of the core's
+// states split over num_threads workers
+void Board_Threads::bfs_solutions(int max_movs, bool moves_given, int num_threads){
+  Sol_Arena arena;
+  std::vector<Sol_Span> solutions;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  core->bfs_solutions(max_movs, num_threads, arena, solutions);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  report_checkpoint();
+  check_memory();
+  print_solutions(solutions, max_movs, moves_given);
+  if(show_stats) print_core_stats(elapsed.count());
+}
+
+// Same again, by a breadth first search that keeps its levels in sorted
+// files under config.temp_dir and sorts in config.ram_bytes of RAM
+void Board_Threads::external_solutions(int max_movs, bool moves_given, const External_Config& config){
+  Sol_Arena arena;
+  std::vector<Sol_Span> solutions;
+  std::string error;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if(!core->external_solutions(max_movs, config, arena, solutions, error)){
+    std::cerr << "ERROR: " << error << std::endl;
+    exit(0);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  report_checkpoint();
+  print_solutions(solutions, max_movs, moves_given);
+  if(show_stats) print_core_stats(elapsed.count());
+}
+
+// Every robot's fewest moves to every cell, from one breadth first search
+// of the core's states that ignores the goals: a grid of move counts per
+// robot, then one path for every cell a robot can get to
+void Board_Threads::all_targets(int max_movs, int num_threads){
+  Sol_Arena arena;
+  std::vector<int> depth;
+  std::vector<Sol_Span> witness;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  core->all_targets(max_movs, num_threads, arena, depth, witness);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  check_memory();
+
+  int rows = orig_board.getRows();
+  int cols = orig_board.getCols();
+  for(unsigned int i = 0; i < orig_board.numRobots(); ++i){
+    std::cout << "robot " << orig_board.getRobot(i) << " reaches each cell in (. if not within "
+      << max_movs << " moves):" << std::endl;
+    std::cout << "   ";
+    for(int c = 1; c <= cols; ++c) std::cout << std::setw(3) << c;
+    std::cout << std::endl;
+    for(int r = 1; r <= rows; ++r){
+      std::cout << std::setw(3) << r;
+      for(int c = 1; c <= cols; ++c){
+        int d = depth[i*rows*cols + (r-1)*cols + (c-1)];
+        if(d < 0) std::cout << "  .";
+        else std::cout << std::setw(3) << d;
       }
-      //Print out the number of moves to solve the board
-      std::cout << "All goals are satisfied after " << one_solu.size() << 
-        " moves" << std::endl << std::endl;
+      std::cout << std::endl;
+    }
+    std::cout << std::endl;
+  }
 
-      //increment index to next solution
-      ++index;
+  for(unsigned int i = 0; i < orig_board.numRobots(); ++i){
+    for(int cell = 0; cell < rows*cols; ++cell){
+      int d = depth[i*rows*cols + cell];
+      if(d <= 0) continue; //never, or where it starts
+      const Sol_Span& path = witness[i*rows*cols + cell];
+      std::cout << "robot " << orig_board.getRobot(i) << " to " << Position(cell/cols + 1, cell%cols + 1)
+        << " in " << d << ":";
+      for(unsigned int q = 0; q < path.size(); ++q){
+        std::cout << (q ? ", " : " ") << orig_board.getRobot(packedRobot(path[q])) << " "
+          << packedDirection(path[q]);
+      }
+      std::cout << std::endl;
     }
   }
-  delete max_moves; //cleans up dynamic memory
+  if(show_stats) print_core_stats(elapsed.count());
+}
+
+// Only the "N different K move solutions:" line, from path counts summed
+// level by level in the breadth first search (no solution is stored)
+void Board_Threads::count_solutions(int max_movs, bool moves_given, int num_threads){
+  int length;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t count = core->count_solutions(max_movs, num_threads, length);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  report_checkpoint();
+  check_memory();
+  if(count == 0 && moves_given){ //no solutions found and max_moves given
+    *out << "no solutions with " << max_movs << " or fewer moves" << std::endl;
+  }
+  else if(count == 0 && !moves_given){ //no solutions and max_moves not given
+    *out << "no solutions" << std::endl;
+  }
+  else{
+    *out << count << " different " << length << " move solutions:" << std::endl;
+  }
+  if(show_stats) print_core_stats(elapsed.count());
+}
+
+// ==================================================================================
+// CHECKPOINTS
+
+void Board_Threads::setCheckpoint(const Checkpoint_Config& config){
+  checkpoint_file = config.filename;
+  core->set_checkpoint(config);
+}
+
+// Nothing here goes to stdout, so a resumed search prints exactly what
+// an uninterrupted one does
+void Board_Threads::report_checkpoint(){
+  if(checkpoint_file.empty()) return;
+  Core_Stats st = core->stats();
+  if(st.checkpoint_ignored){
+    std::cerr << "WARNING: " << checkpoint_file << " is not a checkpoint of this search, started over" << std::endl;
+  }
+  if(st.resumed_depth >= 0){
+    std::cerr << "resumed from " << checkpoint_file << " after level " << st.resumed_depth << std::endl;
+  }
+  if(st.checkpoint_failed){
+    std::cerr << "WARNING: can't write " << checkpoint_file << ", the search went on without it" << std::endl;
+  }
+}
+
+// ==================================================================================
+// MEMORY LIMIT
+
+void Board_Threads::setMemLimit(size_t bytes){
+  core->set_mem_limit(bytes);
+}
+
+// A breadth first search can't forget states the way the depth first
+// ones can, so at the limit it stops and there is no answer to print
+void Board_Threads::check_memory(){
+  Core_Stats st = core->stats();
+  if(!st.out_of_memory) return;
+  std::cerr << "ERROR: the breadth first search needs more than the " << st.mem_limit / (1 << 20)
+    << " MB of -mem_limit (-external keeps its levels on disk instead)" << std::endl;
+  exit(0);
+}
+
+// ==================================================================================
+// DISTANCE TABLES
+// ==================================================================================
+
+// Writes the core's distance table for this board's walls and goals
+void Board_Threads::write_table(const std::string& filename){
+  uint64_t solvable;
+  int deepest;
+  if(!core->write_table(filename, solvable, deepest)){
+    std::cerr << "ERROR: could not write a distance table to " << filename <<
+      " (at most " << MAX_TABLE_PLACEMENTS << " placements of the robots)" << std::endl;
+    exit(0);
+  }
+  std::cout << "distance table " << filename << ": " << solvable <<
+    " placements can reach the goals, the farthest in " << deepest << " moves" << std::endl;
+}
+
+// The same output as all_solutions (or one_solution if all is false), with
+// the solutions read off a table write_table made instead of searched for
+void Board_Threads::table_solutions(const std::string& filename, int max_movs, bool moves_given, bool all){
+  Sol_Arena arena;
+  std::vector<Sol_Span> solutions;
+  std::string error;
+  if(!core->table_solutions(filename, max_movs, arena, solutions, error)){
+    std::cerr << "ERROR: " << error << std::endl;
+    exit(0);
+  }
+  if(all) print_solutions(solutions, max_movs, moves_given);
+  else if(solutions.empty() && moves_given){ //max_moves given
+    std::cout << "no solutions with " << max_movs << " or fewer moves" << std::endl;
+  }
+  else if(solutions.empty()){
+    std::cout << "no solutions" << std::endl;
+  }
+  else print_one_solution(*std::min_element(solutions.begin(), solutions.end()));
 }
 
 // ==================================================================================
@@ -1183,99 +1972,37 @@ void Board_Threads::all_solutions(int max_movs, bool moves_given){
 // ==================================================================================
 
 bool Board_Threads::Board::moveRobot(int i, const std::string &direction) {
+  PROFILE_SCOPE("moveRobot");
   Robot* curr_robot;
   curr_robot = &robots[i];
   Position old_position = curr_robot->pos; //for checking if the position changed
-  int robot_row = (curr_robot->pos).row; //current row
-  int robot_col = (curr_robot->pos).col; //current column
-  bool stop = false;
-  setspot(curr_robot->pos, ' '); //sets old spot to blank initially
+  int robot_row = (curr_robot->pos).row - 1; //current row, as a bit of the column masks
+  int robot_col = (curr_robot->pos).col - 1; //current column, as a bit of the row masks
 
+  //the robot stops at the nearer of the next wall and the next robot,
+  //  each found with one bit scan of its row or column
   if(direction == "north"){
-    while(!stop){
-      if(robot_row <= 0){ //out of bounds
-        stop = true;
-        continue;
-      }
-      else if(getHorizontalWall(double(robot_row) - 0.5, robot_col)){//checking for wall
-        stop = true;
-        continue;
-      }
-      else if(getspot(Position(robot_row-1, robot_col)) != ' '){ //checking for robot
-        stop = true;
-        continue;
-      }
-      else{
-        robot_row -= 1; //robot_row decrement
-      }
-    }
+    robot_row = slideLow(layout->south_walls.col(robot_col), occupied.col(robot_col), robot_row);
   }
   else if(direction == "south"){
-    while(!stop){
-      if(robot_row >= rows){ //out of bounds
-        stop = true;
-        continue;
-      }
-      else if(getHorizontalWall(double(robot_row) + 0.5, robot_col)){//checking for wall
-        stop = true;
-        continue;
-      }
-      else if(getspot(Position(robot_row+1, robot_col)) != ' '){//checking for robot
-        stop = true;
-        continue;
-      }
-      else{
-        robot_row += 1; //robot_row increment
-      }
-    }
+    robot_row = slideHigh(layout->south_walls.col(robot_col), occupied.col(robot_col), robot_row);
   }
   else if(direction == "east"){
-    while(!stop){
-      if(robot_col >= cols){ //out of bounds
-        stop = true;
-        continue;
-      }
-      else if(getVerticalWall(robot_row, double(robot_col) + 0.5)){//checking for wall
-        stop = true;
-        continue;
-      }
-      else if(getspot(Position(robot_row, robot_col + 1)) != ' '){//checking for robot
-        stop = true;
-        continue;
-      }
-      else{
-        robot_col += 1; //robot_col increment
-      }
-    }
+    robot_col = slideHigh(layout->east_walls.row(robot_row), occupied.row(robot_row), robot_col);
   }
   else if(direction == "west"){
-    while(!stop){
-      if(robot_col <= 0){ //out of bounds
-        stop = true;
-        continue;
-      }
-      else if(getVerticalWall(robot_row, double(robot_col) - 0.5)){//checking for wall
-        stop = true;
-        continue;
-      }
-      else if(getspot(Position(robot_row, robot_col - 1)) != ' '){//checking for robot
-        stop = true;
-        continue;
-      }
-      else{
-        robot_col -= 1; //robot_col decrement
-      }
-    }
+    robot_col = slideLow(layout->east_walls.row(robot_row), occupied.row(robot_row), robot_col);
   }
-  curr_robot->pos = Position(robot_row, robot_col); //sets new position
-  setspot(curr_robot->pos, curr_robot->which); //updates the board
-  //if the position did not change, just resets board to how it was
-  if(curr_robot->pos == old_position){
+  //if the position did not change, the board is as it was
+  if(Position(robot_row + 1, robot_col + 1) == old_position){
     return false; //false if the robot did not move
   }
-  else{
-    return true; //true if the robot did move
-  }
+  setspot(curr_robot->pos, ' '); //clears the old spot
+  curr_robot->pos = Position(robot_row + 1, robot_col + 1); //sets new position
+  hash ^= layout->zobristKey(curr_robot->which, old_position) ^
+    layout->zobristKey(curr_robot->which, curr_robot->pos);
+  setspot(curr_robot->pos, curr_robot->which); //updates the board
+  return true; //true if the robot did move
 }
 
 
@@ -1312,7 +2039,7 @@ void Board_Threads::Board::addGoal(const std::string &gr, const Position &p) {
   assert (isGoal(p) == ' ');
 
   // add this goal label and position to the vector of goals
-  goals.push_back(Goal(p,goal_robot));
+  layout->goals.push_back(Goal(p,goal_robot));
 }
 
 
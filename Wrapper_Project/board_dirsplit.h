@@ -10,6 +10,25 @@
 #include <cstdlib>
 #include <thread>
 #include <map>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include "line_masks.h"
+
+// Compile-time limits of the flat board representation (override with -D)
+#ifndef BOARD_MAX_DIM
+#define BOARD_MAX_DIM 64
+#endif
+static_assert(BOARD_MAX_DIM <= LINE_MASK_BITS, "a row or column must fit in a Line_Mask");
+#ifndef BOARD_MAX_ROBOTS
+#define BOARD_MAX_ROBOTS 16
+#endif
+// Most states (one byte each) the dedup table may index densely
+#ifndef BOARD_DENSE_STATES
+#define BOARD_DENSE_STATES (1 << 26)
+#endif
 
 // ==================================================================
 // ==================================================================
@@ -35,13 +54,35 @@ bool operator!=(const Position &a, const Position &b);
 
 class Robot {
 public:
+  Robot() : which(' ') {} //empty slot in a Robot_Snapshot
   Robot(Position p, char w) : pos(p), which(w) { 
     assert (isalpha(w) && isupper(w)); }
-  Robot(const Robot &old) : pos(old.pos), which(old.which){};
   Position pos;
   char which;
 };
 
+// ==================================================================
+// ==================================================================
+// The robots of a board in a fixed-size array.  This is the only part
+// of a board that each thread needs its own copy of, and it is
+// trivially copyable so that copy is a flat memcpy.
+
+class Robot_Snapshot {
+public:
+  Robot_Snapshot() : count(0) {}
+  unsigned int size() const { return count; }
+  Robot& operator[](unsigned int i) { return robots[i]; }
+  const Robot& operator[](unsigned int i) const { return robots[i]; }
+  void push_back(const Robot &r) { assert (count < BOARD_MAX_ROBOTS); robots[count++] = r; }
+  const Robot* begin() const { return robots; }
+  const Robot* end() const { return robots + count; }
+private:
+  unsigned int count;
+  Robot robots[BOARD_MAX_ROBOTS];
+};
+static_assert(std::is_trivially_copyable<Robot_Snapshot>::value,
+  "thread copies of the robots must stay a flat memcpy");
+
 
 // ==================================================================
 // ==================================================================
@@ -59,6 +100,47 @@ public:
   char which;
 };
 
+
+// ==================================================================
+// ==================================================================
+// The parts of a puzzle that never change once it is loaded: the
+// walls, in flat grids sized at compile time, and the goals.  Every
+// thread's board points at the one layout built by load().
+
+class Board_Layout {
+public:
+  Board_Layout(int num_rows, int num_cols);
+  // vertical_walls[r][c] is the wall just west of cell (r+1,c+1) and
+  // horizontal_walls[r][c] the wall just north of it
+  bool vertical_walls[BOARD_MAX_DIM][BOARD_MAX_DIM+1];
+  bool horizontal_walls[BOARD_MAX_DIM+1][BOARD_MAX_DIM];
+  std::vector<Goal> goals;
+
+  // GEOMETRY worked out once by analyze() after the board is loaded
+  void analyze(int rows, int cols);
+  // wall_stop[r][c]: a robot stops in cell (r+1,c+1) against a wall in
+  //  some direction; any other cell needs a robot next to it as a blocker
+  bool wall_stop[BOARD_MAX_DIM][BOARD_MAX_DIM];
+  // the walls as Line_Masks for moveRobot: cells with a wall on their
+  //  east side (by row) and on their south side (by column)
+  Line_Masks east_walls;
+  Line_Masks south_walls;
+  // goal_dist[g][r*cols+c]: fewest slides from cell (r+1,c+1) to goal g
+  //  for a robot that could stop anywhere along a slide (0xFF if never)
+  std::vector<std::vector<unsigned char> > goal_dist;
+  // the goal is not a wall stop, so another robot has to be beside it
+  std::vector<bool> goal_needs_blocker;
+
+  // ZOBRIST keys, random but the same every run: a board's hash is the
+  //  XOR of one key per robot (by letter) and cell, and the dedup key
+  //  XORs in the direction of the last move too
+  uint64_t zobrist[26][BOARD_MAX_DIM][BOARD_MAX_DIM];
+  uint64_t zobrist_dir[4];
+  uint64_t zobristKey(char which, const Position& p) const {
+    return zobrist[which - 'A'][p.row-1][p.col-1];
+  }
+};
+
 //Helper class, keeps the new position moved to and direction of movement
 class Move{
 public:
@@ -83,28 +165,203 @@ public:
 
 };
 
+// A move packed into one byte for the solution arena: robot index in the
+// high six bits, direction in the low two.  Directions are numbered in the
+// order their names sort (east, north, south, west), but getKey() writes
+// the robot index in decimal, so past ten robots the bytes do not sort in
+// Solution::getKey() order; Sol_Span's operator< ranks them into it.
+typedef unsigned char PackedMove;
+PackedMove packMove(int robot_index, const std::string &direction);
+int packedRobot(PackedMove pm);
+const std::string& packedDirection(PackedMove pm);
+
+//Helper class, a lightweight view of a solution path stored in a Sol_Arena
+class Sol_Span{
+public:
+  Sol_Span(const PackedMove* m = NULL, unsigned int n = 0) : moves(m), length(n) {}
+  unsigned int size() const { return length; }
+  PackedMove operator[](unsigned int i) const { return moves[i]; }
+  const PackedMove* moves;
+  unsigned int length;
+};
+
+// spans compare by their moves (getKey() order), not by address or byte
+bool operator<(const Sol_Span &a, const Sol_Span &b);
+bool operator==(const Sol_Span &a, const Sol_Span &b);
+
+// Per-thread bump allocator for found solution paths.  Each path is copied
+// in once as contiguous packed moves and handed back as a Sol_Span; nothing
+// is freed until release() drops every block in one shot after the solve.
+class Sol_Arena{
+public:
+  static const unsigned int BLOCK_SIZE = 4096;
+  Sol_Arena() : used(BLOCK_SIZE) {}
+  ~Sol_Arena(){ release(); }
+  Sol_Span record(const std::vector<Move>& path);
+  Sol_Span record(const PackedMove* moves, unsigned int length);
+  void release();
+  size_t bytes() const { return blocks.size() * BLOCK_SIZE; }
+  void swap(Sol_Arena& other) { blocks.swap(other.blocks); std::swap(used, other.used); }
+
+private:
+  PackedMove* allocate(unsigned int length);
+
+  // spans point into the blocks, so an arena is never copied
+  Sol_Arena(const Sol_Arena&);
+  void operator=(const Sol_Arena&);
+
+  std::vector<PackedMove*> blocks;
+  unsigned int used; //bytes used in blocks.back()
+};
+
+// the compile-time specialized search core (solver_core.h)
+class Core_Solver;
+class External_Config;
+class Checkpoint_Config;
+
+// The threads' table of states seen under -mem_limit, in place of the
+// unbounded all_boards: a fixed number of buckets of STATE_WAYS hashes,
+// each with the fewest moves it was reached in.  A full bucket gives up
+// its deepest entry to a state reached in no more moves, and otherwise
+// the new state is not kept: a shallow state cuts off the most search,
+// and a state that is forgotten only costs searching it again.
+class Bounded_States {
+public:
+  Bounded_States() : replaced(0), dropped(0) {}
+  void resize(size_t bytes); //as many buckets as fit, emptied
+  void clear();
+  // checkState2's rule: true if hash was reached in fewer than move moves
+  bool check(uint64_t hash, int move);
+  size_t bytes() const { return buckets.size() * sizeof(Bucket); }
+  bool empty() const { return buckets.empty(); }
+  uint64_t replaced; //entries given up for a shallower state
+  uint64_t dropped; //states not kept since their bucket was all shallower
+private:
+  static const int STATE_WAYS = 4;
+  static const unsigned char UNSEEN = 0xFF;
+  class Bucket {
+  public:
+    uint64_t hash[STATE_WAYS];
+    unsigned char move[STATE_WAYS];
+  };
+  std::vector<Bucket> buckets;
+};
+
 // Global Singleton All Solutions class
 class Sol_Singleton{
 public:
-  Sol_Singleton(){ init = true; };
+  Sol_Singleton() : verify(false), collisions(0), dense_size(0), max_moves(0), mem_limit(0),
+    stop_on_solution(false), stop(false) { init = true; };
   ~Sol_Singleton(){ init = false; };
   static Sol_Singleton* getInstance();
-  void addState(std::string key, Solution sol);
-  std::map<std::string, Solution>& getSolutions(){ return all_solutions; };
   // new functions, added by Allan
   bool checkState(std::string key, Solution new_sol);
-  bool checkState2(std::string key);
+  bool checkState2(uint64_t hash, int move, const std::string& state);
+  // the same for the state numbered rank by Board::stateRank(), when the
+  //  board is small enough for every state to have a slot (no lock taken)
+  bool checkRank(uint64_t rank, int move);
+  // picks the dense table if rows*cols cells, the robots and the last
+  //  direction moved give at most BOARD_DENSE_STATES states, else hashing
+  void sizeStates(int rows, int cols, int robots);
+  bool denseStates() const { return dense_size != 0; }
+  // the most moves the searches go to: the dense table keeps them in a
+  //  byte, so a search deeper than DENSE_MAX_MOVES gets the hashes; call
+  //  before sizeStates()
+  static const int DENSE_MAX_MOVES = 254;
+  void setMaxMoves(int moves){ max_moves = moves; }
+  // keep the full state (getKey3()) with every hash and count the hashes
+  //  two different states share; this turns the dense table off
+  void setVerifyHashes(bool on);
+  bool verifyHashes() const { return verify; }
+  unsigned long hashCollisions() const { return collisions; }
+  // -mem_limit: the states table gets half of bytes (dense only if it
+  //  fits, else a Bounded_States) and the threads pack their solutions
+  //  as they go; call before sizeStates()
+  void setMemLimit(size_t bytes){ mem_limit = bytes; }
+  size_t memLimit() const { return mem_limit; }
+  // what the states table holds now (estimated for the hash map), and
+  //  under the limit how many entries it replaced and did not keep
+  size_t statesBytes() const;
+  uint64_t statesReplaced() const { return bounded.replaced; }
+  uint64_t statesDropped() const { return bounded.dropped; }
   std::map<std::string, Solution> all_states;
   void addStateToAllStates(std::string key, Solution sol);
-  void addBoardToAllBoards(std::string key);
+  void clearStates();
+
+  // cooperative cancellation for one_solution: once it is turned on the
+  //  first solution any thread records tells every thread to stop
+  void setStopOnSolution(bool on){ stop_on_solution = on; stop = false; }
+  void solutionFound(){ if(stop_on_solution) stop = true; }
+  bool stopRequested() const { return stop.load(std::memory_order_relaxed); }
 
 private:
   static Sol_Singleton* instance;
   static bool init;
 
-  std::map<std::string, Solution> all_solutions;
-  std::map<std::string , bool> all_boards;
-  
+  // shallowest move number each board state has been reached at, by
+  //  Board::stateHash() (with the state itself when verifying)
+  std::unordered_map<uint64_t, int> all_boards;
+  std::unordered_map<uint64_t, std::string> hashed_states;
+  bool verify;
+  unsigned long collisions;
+  // or, with denseStates(), the same by rank (DENSE_UNSEEN if never)
+  static const unsigned char DENSE_UNSEEN = 0xFF;
+  std::unique_ptr<std::atomic<unsigned char>[]> dense_moves;
+  uint64_t dense_size;
+  int max_moves;
+  // or, under the memory limit, instead of all_boards
+  size_t mem_limit;
+  Bounded_States bounded;
+
+  bool stop_on_solution;
+  std::atomic<bool> stop;
+};
+
+
+// What one search thread did with its subtree, for the -stats report
+class Search_Stats {
+public:
+  Search_Stats() : robot(-1), wall_ms(0), cpu_ms(0), nodes(0), dedup_hits(0), first_solution(0) {}
+  std::string task; //root function the thread ran
+  int robot; //and the robot it was given
+  double wall_ms;
+  double cpu_ms;
+  unsigned long nodes; //one_sol_helper(_other) calls past the move limit check
+  unsigned long dedup_hits; //states checkState2 cut off
+  unsigned long first_solution; //nodes when the first solution was recorded (0 if none)
+};
+
+
+// ==================================================================
+// ==================================================================
+// Move ordering for one thread's depth first search, so a solution (and
+// with it a lower max_moves for every thread) turns up sooner.  Moves
+// are tried killers first (the moves the thread's latest solutions made
+// at this depth), then by movesNeeded() after the move, then by the
+// history table (how many of the thread's solutions the move was on).
+
+class Move_Choice {
+public:
+  PackedMove move;
+  Position to; //where the robot stops, when ordering worked it out
+  int killer; //0 or 1 for the killer slots, 2 for neither
+  int needed; //movesNeeded() once the move is made
+  unsigned int history;
+};
+
+class Move_Order {
+public:
+  Move_Order();
+  // every move on a solution just found
+  void reward(const std::vector<Move>& path);
+  // stable, so ties keep the fixed order they were generated in
+  void sort(Move_Choice* choices, int n, int depth) const;
+  // the killers are kept this deep; the threads take any -max_moves, and
+  //  deeper moves are ordered without them
+  static const int KILLER_DEPTHS = 256;
+private:
+  unsigned int history[256]; //by PackedMove
+  PackedMove killer[KILLER_DEPTHS][2]; //by depth, most recent first
 };
 
 
@@ -137,20 +394,32 @@ public:
     // ACCESSORS related to the robots and their current positions
     unsigned int numRobots() const { return robots.size(); }
     char getRobot(int i) const { assert (i >= 0 && i < (int)numRobots()); return robots[i].which; }
-    std::vector<Robot>& getRobots(){ return robots; };
     Position getRobotPosition(int i) const { assert (i >= 0 && i < (int)numRobots()); return robots[i].pos; }
     
     // ACCESSORS related to the overall puzzle goals
-    unsigned int numGoals() const { return goals.size(); }
+    unsigned int numGoals() const { return layout->goals.size(); }
     // (if any robot is allowed to reach the goal, this value is '?')
-    char getGoalRobot(int i) const { assert (i >= 0 && i < (int)numGoals()); return goals[i].which; }
-    Position getGoalPosition(int i) const { assert (i >= 0 && i < (int)numGoals()); return goals[i].pos; }
+    char getGoalRobot(int i) const { assert (i >= 0 && i < (int)numGoals()); return layout->goals[i].which; }
+    Position getGoalPosition(int i) const { assert (i >= 0 && i < (int)numGoals()); return layout->goals[i].pos; }
     
     std::string getKey3();
+    // the robot cells (row-major) as digits in base rows*cols, under the
+    //  packed direction of the last move: a number for every state that
+    //  getKey3() plus the direction would name
+    uint64_t stateRank(int dir) const;
+    // the Zobrist hash of the robots, kept up to date by every move and
+    //  undo, under the packed direction of the last move
+    uint64_t stateHash(int dir) const { return hash ^ layout->zobrist_dir[dir]; }
     
     // MODIFIERS related to board geometry
     void addHorizontalWall(double r, int c);
     void addVerticalWall(int r, double c);
+    // why the wall, robot or goal could not be added ("" if it can), for
+    //  input that must not trip the asserts in the modifiers
+    std::string checkHorizontalWall(double r, int c) const;
+    std::string checkVerticalWall(int r, double c) const;
+    std::string checkRobot(const Position &p, char a) const;
+    std::string checkGoal(const std::string &goal_robot, const Position &p) const;
 
     // MODIFIERS related to robot position
     // initial placement of a new robot
@@ -160,6 +429,8 @@ public:
 
     // MODIFIER related to puzzle goals
     void addGoal(const std::string &goal_robot, const Position &p);
+    // once every wall and goal is in, see Board_Layout::analyze
+    void analyzeGeometry(){ layout->analyze(rows, cols); }
 
     // PRINT
     void print();
@@ -169,21 +440,35 @@ public:
 
     //CHECK GOALS
     bool checkGoals(); //goes through goals and sees if they are all satisfied
+    //fewest moves that could satisfy every goal from here (a lower bound)
+    int movesNeeded() const;
+
+    // SOLUTIONS found by this board's thread (stored in its arena)
+    void recordSolution(const std::vector<Move>& path);
+    const std::vector<Sol_Span>& getFound() const { return found; }
+    void releaseSolutions();
+    size_t solutionBytes() const { return arena.bytes() + found.capacity() * sizeof(Sol_Span); }
+
+    // MOVE ORDERING of the depth first search, on unless -fixed_order
+    void setMoveOrdering(bool on){ ordering = on; }
+
+    // STATS about the search this board ran
+    Search_Stats& getStats() { return stats; }
 
     // ONE-SOLUTION
-    void one_sol_helper(int i, int move, int* max_moves, std::vector<Move>& path);
-    void one_sol_helper_other(int i, int move, int* max_moves,
+    void one_sol_helper(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path);
+    void one_sol_helper_other(int i, int move, std::atomic<int>* max_moves,
       std::vector<Move>& path);
 
-    void one_sol_north(int i, int move, int* max_moves, std::vector<Move>& path); 
-    void one_sol_east(int i, int move, int* max_moves, std::vector<Move>& path);
-    void one_sol_west(int i, int move, int* max_moves, std::vector<Move>& path);
-    void one_sol_south(int i, int move, int* max_moves, std::vector<Move>& path);
+    void one_sol_north(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path); 
+    void one_sol_east(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path);
+    void one_sol_west(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path);
+    void one_sol_south(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path);
 
-    void one_sol_other_north(int i, int move, int* max_moves, std::vector<Move>& path); 
-    void one_sol_other_east(int i, int move, int* max_moves, std::vector<Move>& path);
-    void one_sol_other_west(int i, int move, int* max_moves, std::vector<Move>& path);
-    void one_sol_other_south(int i, int move, int* max_moves, std::vector<Move>& path);
+    void one_sol_other_north(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path); 
+    void one_sol_other_east(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path);
+    void one_sol_other_west(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path);
+    void one_sol_other_south(int i, int move, std::atomic<int>* max_moves, std::vector<Move>& path);
 
   private:
 
@@ -191,52 +476,123 @@ public:
     char getspot(const Position &p) const;
     void setspot(const Position &p, char a);
     char isGoal(const Position &p) const;
+    void syncCells(); //refills board from the robots after a copy
+    int orderMoves(int first, int last, std::vector<Move>& path, int moves_left,
+      Move_Choice* choices);
+    bool makeMove(const Move_Choice& choice);
+    void dropLonger(unsigned int length); //packs the arena once most of it is stale
+    void undoMove(Robot* robot, const Position& orig_pos); //puts robot back
 
     // REPRESENTATION
 
-    // the board geometry
+    // the board geometry; the walls & goals are shared read-only by
+    // every copy of the board instead of being deep-copied per thread
     int rows;
     int cols;
-    std::vector<std::vector<char> > board;
-    std::vector<std::vector<bool> > vertical_walls;
-    std::vector<std::vector<bool> > horizontal_walls;
+    std::shared_ptr<Board_Layout> layout;
 
     // the names and current positions of the robots
-    std::vector<Robot> robots;
+    Robot_Snapshot robots;
 
-    // the goal positions & the robots that must reach them
-    std::vector<Goal> goals;
+    // which robot (or ' ') is in each cell, derived from the robots
+    char board[BOARD_MAX_DIM][BOARD_MAX_DIM];
+    // and the same by row and column, for the slides
+    Line_Masks occupied;
+    // and the Zobrist hash of where they are
+    uint64_t hash;
 
-    // vector of solutions
-    std::vector<Solution> solutions;
+    // solutions found by this board, packed into its own arena
+    Sol_Arena arena;
+    std::vector<Sol_Span> found;
 
-    // states
+    Search_Stats stats;
 
+    // this thread's move ordering (history and killers start over with
+    //  each search, since every search gets fresh board copies)
+    bool ordering;
+    Move_Order order;
   };
   
   Board_Threads();
   ~Board_Threads();
 
   void make_copies();
+  void delete_copies();
 
   bool usage(const std::string &executable_name);
 
   Board load(const std::string &executable, const std::string &filename);
+  // the same from any stream, false (with the reason in error) if it is
+  //  not a puzzle, with nothing printed and the process left running
+  static bool parse(std::istream &istr, Board &answer, std::string &error);
 
   void set_orig_board(const std::string &executable, const std::string &filename);
+  // the same for a board that is already loaded; the threads' dedup table
+  //  (Sol_Singleton::sizeStates()) is left to the caller
+  void use_board(const Board &board, uint64_t hash);
   Board& getOrig();
 
   void one_solution(int max_movs, bool moves_given);
+  void anytime_solution(int max_movs, bool moves_given, int budget_ms); //core, best by a deadline
+  void print_one_solution(const Sol_Span& one_sol);
 
   // ALL-SOLUTIONS
   void all_solutions(int max_movs, bool moves_given); //uses one_solution functions
+  void core_solutions(int max_movs, bool moves_given); //uses the specialized core
+  void bfs_solutions(int max_movs, bool moves_given, int num_threads); //core, breadth first
+  void count_solutions(int max_movs, bool moves_given, int num_threads); //just the count line
+  void external_solutions(int max_movs, bool moves_given, const External_Config& config); //levels on disk
+  void all_targets(int max_movs, int num_threads); //every robot to every cell, goals ignored
+  void print_solutions(std::vector<Sol_Span>& solutions, int max_moves, bool moves_given);
+
+  // DISTANCE TABLES (distance_table.h): every start position's distance to
+  //  the goals, written once and then mapped to answer with no search
+  void write_table(const std::string& filename);
+  void table_solutions(const std::string& filename, int max_movs, bool moves_given, bool all);
+
+  // STATS printed after the threads of each search are joined (-stats)
+  void setShowStats(bool on){ show_stats = on; }
+  void print_stats();
+  void print_core_stats(double seconds); //after -core, -bfs, -count_only, -all_targets or -external
+
+  // CHECKPOINTS (checkpoint.h) of -bfs, -count_only and -external, after
+  //  the board is loaded; report_checkpoint() notes on stderr how they went
+  void setCheckpoint(const Checkpoint_Config& config);
+  void report_checkpoint();
+
+  // MEMORY LIMIT (-mem_limit) of the core's searches, after the board is
+  //  loaded (the threads' is Sol_Singleton::setMemLimit(), before);
+  //  check_memory() ends the run if a breadth first search hit it
+  void setMemLimit(size_t bytes);
+  void check_memory();
+
+  // print_solutions writes the binary format of sol_format.h instead of text
+  void setBinaryOutput(bool on){ binary_output = on; }
+  // where print_solutions and count_solutions write (std::cout by default)
+  void setOutput(std::ostream& o){ out = &o; }
+
+  // the threads try moves in a fixed order instead of by Move_Order
+  void setMoveOrdering(bool on){ orig_board.setMoveOrdering(on); }
+  // one_solution finishes the winning pass to print the same solution
+  //  every run, not just the first one some thread got to (-deterministic)
+  void setDeterministic(bool on){ deterministic = on; }
 
 private:
+  // runs the per robot/direction threads over fresh board copies
+  void search_threads(std::atomic<int>* max_moves);
+
   Board orig_board;
+  Core_Solver* core; //picked for the board's shape when it is loaded
   std::vector<Board*> thread_boards;
   int num_robots;
 
   std::vector<std::thread> threads;
+  bool show_stats;
+  bool deterministic;
+  bool binary_output;
+  uint64_t puzzle_hash; //of the puzzle file, for the binary header
+  std::string checkpoint_file; //empty for no checkpoints
+  std::ostream* out;
 };
 
 #endif
\ No newline at end of file
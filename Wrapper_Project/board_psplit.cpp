@@ -55,6 +55,7 @@ std::string Solution::getKey(){
 Board_Threads::Board::Board(){
   rows = 0;
   cols = 0;
+  masked = false;
 }
 
 Board_Threads::Board::~Board(){}
@@ -81,6 +82,14 @@ Board_Threads::Board::Board(int r, int c) {
   for (int i = 0; i < cols; i++) {
     horizontal_walls[0][i] = horizontal_walls[rows][i] = true;
   }
+
+  // boards that fit in a Line_Mask slide by bit scans (see moveRobot),
+  //  with the east and south borders as walls in the masks
+  masked = rows <= LINE_MASK_BITS && cols <= LINE_MASK_BITS;
+  if (masked) {
+    for (int i = 0; i < rows; i++) east_walls.add(i, cols-1);
+    for (int i = 0; i < cols; i++) south_walls.add(rows-1, i);
+  }
 }
 
 
@@ -94,6 +103,10 @@ Board_Threads::Board::Board(const Board& old_board){
   board = old_board.board;
   vertical_walls = old_board.vertical_walls;
   horizontal_walls = old_board.horizontal_walls;
+  masked = old_board.masked;
+  east_walls = old_board.east_walls;
+  south_walls = old_board.south_walls;
+  occupied = old_board.occupied;
   robots = old_board.robots;
   goals = old_board.goals;
   solutions = old_board.solutions;
@@ -105,6 +118,10 @@ void Board_Threads::Board::operator=(const Board_Threads::Board& old_board){
   board = old_board.board;
   vertical_walls = old_board.vertical_walls;
   horizontal_walls = old_board.horizontal_walls;
+  masked = old_board.masked;
+  east_walls = old_board.east_walls;
+  south_walls = old_board.south_walls;
+  occupied = old_board.occupied;
   robots = old_board.robots;
   goals = old_board.goals;
   solutions = old_board.solutions;
@@ -230,6 +247,8 @@ void Board_Threads::Board::addHorizontalWall(double r, int c) {
   assert (horizontal_walls[floor(r)][c-1] == false);
   // subtract one and round down because the corner is (0,0) not (1,1)
   horizontal_walls[floor(r)][c-1] = true;
+  // the wall on the south side of the cell above it
+  if (masked && floor(r) >= 1) south_walls.add(int(floor(r))-1, c-1);
 }
 
 // Add an interior vertical wall
@@ -243,6 +262,8 @@ void Board_Threads::Board::addVerticalWall(int r, double c) {
   assert (vertical_walls[r-1][floor(c)] == false);
   // subtract one and round down because the corner is (0,0) not (1,1)
   vertical_walls[r-1][floor(c)] = true;
+  // the wall on the east side of the cell west of it
+  if (masked && floor(c) >= 1) east_walls.add(r-1, int(floor(c))-1);
 }
 
 
@@ -265,6 +286,11 @@ void Board_Threads::Board::setspot(const Position &p, char a) {
   assert (p.col >= 1 && p.col <= cols);
   // subtract one from each coordinate because the corner is (0,0) not (1,1)
   board[p.row-1][p.col-1] = a;
+  // and keep the row and column masks in step
+  if (masked) {
+    if (a == ' ') occupied.remove(p.row-1, p.col-1);
+    else occupied.add(p.row-1, p.col-1);
+  }
 }
 
 char Board_Threads::Board::isGoal(const Position &p) const {
@@ -724,7 +750,23 @@ bool Board_Threads::Board::moveRobot(int i, const std::string &direction) {
   bool stop = false;
   setspot(curr_robot->pos, ' '); //sets old spot to blank initially
 
-  if(direction == "north"){
+  if(masked){
+    //the nearer of the next wall and the next robot, each found with one
+    //  bit scan of the row or column (bits count from 0)
+    if(direction == "north"){
+      robot_row = slideLow(south_walls.col(robot_col-1), occupied.col(robot_col-1), robot_row-1) + 1;
+    }
+    else if(direction == "south"){
+      robot_row = slideHigh(south_walls.col(robot_col-1), occupied.col(robot_col-1), robot_row-1) + 1;
+    }
+    else if(direction == "east"){
+      robot_col = slideHigh(east_walls.row(robot_row-1), occupied.row(robot_row-1), robot_col-1) + 1;
+    }
+    else if(direction == "west"){
+      robot_col = slideLow(east_walls.row(robot_row-1), occupied.row(robot_row-1), robot_col-1) + 1;
+    }
+  }
+  else if(direction == "north"){
     while(!stop){
       if(robot_row <= 0){ //out of bounds
         stop = true;
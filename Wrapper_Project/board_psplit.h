@@ -5,6 +5,7 @@
 #include <cassert>
 #include <vector>
 #include <string>
+#include "line_masks.h"
 #include <iomanip>
 #include <fstream>
 #include <cstdlib>
@@ -175,6 +176,13 @@ public:
     std::vector<std::vector<char> > board;
     std::vector<std::vector<bool> > vertical_walls;
     std::vector<std::vector<bool> > horizontal_walls;
+    // the same walls and the robots as Line_Masks, when the board fits
+    //  in them: cells with a wall on their east side (by row), on their
+    //  south side (by column), and with a robot in them
+    bool masked;
+    Line_Masks east_walls;
+    Line_Masks south_walls;
+    Line_Masks occupied;
 
     // the names and current positions of the robots
     std::vector<Robot> robots;
@@ -0,0 +1,31 @@
+#include <cstdio>
+#include "checkpoint.h"
+
+// ==================================================================
+// ==================================================================
+// Implementation of the Checkpoint_Writer and Checkpoint_Reader
+
+bool Checkpoint_Writer::open(const std::string& filename){
+  final_name = filename;
+  tmp_name = filename + ".tmp";
+  return out.open(tmp_name);
+}
+
+bool Checkpoint_Writer::commit(){
+  if(!out.close(true) || std::rename(tmp_name.c_str(), final_name.c_str()) != 0){
+    std::remove(tmp_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool Checkpoint_Reader::open(const std::string& filename){
+  return in.open(filename, 1, EXTERNAL_IO_BUFFER);
+}
+
+bool Checkpoint_Reader::text(std::string& s){
+  uint32_t n;
+  if(!u32(n)) return false;
+  s.resize(n);
+  return n == 0 || bytes(&s[0], n);
+}
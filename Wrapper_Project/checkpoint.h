@@ -0,0 +1,152 @@
+#ifndef __checkpoint_h_
+#define __checkpoint_h_
+
+#include <string>
+#include <cstdint>
+#include "external_bfs.h"
+
+// ==================================================================
+// ==================================================================
+// Checkpoints of the breadth first searches (-checkpoint, -resume).  A
+// search is written out at a level barrier, the one point where it is
+// nothing but the levels it has finished.  A checkpoint is only for
+// resuming on the machine that wrote it, so everything is in its byte
+// order:
+//
+//   "RRCP"        magic
+//   u8  version   CHECKPOINT_VERSION
+//   u8  mode      CHECKPOINT_BFS, CHECKPOINT_COUNT or CHECKPOINT_EXTERNAL
+//   u8  key bytes
+//   u64 layout    Solver_Core::layoutHash() of the walls and goals
+//   key start     the start state's packed key
+//   u32 depth     the last level that is complete
+//
+// then for CHECKPOINT_BFS and CHECKPOINT_COUNT the visited table (see
+// Visited_Table::save()) and for CHECKPOINT_EXTERNAL, whose levels are
+// files already, the name prefix they share (u32 length and the bytes),
+// the u64 next file number and the u64 states in them.
+// It is written to <file>.tmp, synced and renamed over <file>, so a kill
+// at any moment leaves either the last checkpoint or the new one whole.
+
+static const unsigned char CHECKPOINT_VERSION = 1;
+enum Checkpoint_Mode { CHECKPOINT_BFS = 1, CHECKPOINT_COUNT = 2, CHECKPOINT_EXTERNAL = 3 };
+
+class Checkpoint_Writer {
+public:
+  bool open(const std::string& filename); //writes filename.tmp
+  void u8(unsigned char v) { out.write(&v, 1); }
+  void u32(uint32_t v) { out.write(&v, 4); }
+  void u64(uint64_t v) { out.write(&v, 8); }
+  void bytes(const void* p, size_t n) { out.write(p, n); }
+  void text(const std::string& s) { u32(s.size()); bytes(s.data(), s.size()); }
+  bool commit(); //synced and renamed over filename; false if it failed
+  uint64_t written() const { return out.bytes(); }
+private:
+  std::string final_name, tmp_name;
+  Record_Writer out;
+};
+
+class Checkpoint_Reader {
+public:
+  bool open(const std::string& filename); //false if there is none
+  bool u8(unsigned char& v) { return in.readBytes(&v, 1); }
+  bool u32(uint32_t& v) { return in.readBytes(&v, 4); }
+  bool u64(uint64_t& v) { return in.readBytes(&v, 8); }
+  bool bytes(void* p, size_t n) { return in.readBytes(p, n); }
+  bool text(std::string& s);
+private:
+  Record_Reader in;
+};
+
+// The header, for the search in mode over core at the end of level depth
+template <class Core>
+void writeCheckpointHeader(Checkpoint_Writer& out, const Core& core, int mode, int depth){
+  typename Core::Key start = core.key(core.start());
+  out.bytes("RRCP", 4);
+  out.u8(CHECKPOINT_VERSION);
+  out.u8(mode);
+  out.u8(sizeof(start));
+  out.u64(core.layoutHash());
+  out.bytes(&start, sizeof(start));
+  out.u32(depth);
+}
+
+// Reads the header back, true (with the level it ends at in depth) only
+// if it was written by a search in mode over this very puzzle
+template <class Core>
+bool readCheckpointHeader(Checkpoint_Reader& in, const Core& core, int mode, int& depth){
+  typename Core::Key start = core.key(core.start()), k;
+  char magic[4];
+  unsigned char version, m, key_bytes;
+  uint64_t layout;
+  uint32_t d;
+  if(!in.bytes(magic, 4) || std::string(magic, 4) != "RRCP") return false;
+  if(!in.u8(version) || version != CHECKPOINT_VERSION) return false;
+  if(!in.u8(m) || m != mode) return false;
+  if(!in.u8(key_bytes) || key_bytes != sizeof(start)) return false;
+  if(!in.u64(layout) || layout != core.layoutHash()) return false;
+  if(!in.bytes(&k, sizeof(k)) || k != start) return false;
+  if(!in.u32(d)) return false;
+  depth = d;
+  return true;
+}
+
+
+// ==================================================================
+// Implementation of the External_BFS members that use checkpoints
+
+// The level files checkpoint.filename names, if resuming from it and
+// they are all still there; returns the level they end at, or 0 to start
+// from scratch
+template <class Core>
+int External_BFS<Core>::resume(){
+  if(!checkpoint.resume || checkpoint.filename.empty()) return 0;
+  Checkpoint_Reader in;
+  if(!in.open(checkpoint.filename)) return 0;
+  int depth;
+  std::string old_prefix;
+  uint64_t old_next, states;
+  bool ok = readCheckpointHeader(in, core, CHECKPOINT_EXTERNAL, depth) && depth >= 1 &&
+    in.text(old_prefix) && in.u64(old_next) && in.u64(states);
+  for(int d = 0; ok && d <= depth; ++d){
+    FILE* f = fopen((old_prefix + "level" + std::to_string(d)).c_str(), "rb");
+    if(f == NULL) ok = false;
+    else fclose(f);
+  }
+  if(!ok){
+    st.checkpoint_ignored = true;
+    return 0;
+  }
+  // carry on under the old names (a half written level or run of the
+  //  killed search is simply written over)
+  prefix = old_prefix;
+  next_file = old_next;
+  for(int d = 0; d <= depth; ++d) levels.push_back(fileName("level", d));
+  st.states = states;
+  st.table_bytes = states * sizeof(Key);
+  st.resumed_depth = depth;
+  return depth;
+}
+
+// Checkpoints the search after level depth: the levels are on disk, so
+// this is only their names
+template <class Core>
+void External_BFS<Core>::save(int depth){
+  Checkpoint_Writer out;
+  bool ok = out.open(checkpoint.filename);
+  if(ok){
+    writeCheckpointHeader(out, core, CHECKPOINT_EXTERNAL, depth);
+    out.text(prefix);
+    out.u64(next_file);
+    out.u64(st.states);
+    ok = out.commit();
+  }
+  if(!ok){
+    st.checkpoint_failed = true;
+    return;
+  }
+  ++st.checkpoints;
+  st.checkpoint_bytes = out.written();
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "distance_table.h"
+
+// ==================================================================
+// ==================================================================
+// Implementation of the Distance_Table
+
+Distance_Table::~Distance_Table(){
+  if(map) munmap(map, map_size);
+}
+
+static uint64_t readLittle(const unsigned char* bytes, int n){
+  uint64_t v = 0;
+  for(int b = 0; b < n; ++b) v |= (uint64_t)bytes[b] << (8*b);
+  return v;
+}
+
+bool Distance_Table::open(const std::string& filename, int rows, int cols, int robots,
+    uint64_t layout, std::string& error){
+  assert (map == NULL);
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0){
+    error = "can't open " + filename;
+    return false;
+  }
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size < DISTANCE_TABLE_HEADER){
+    close(fd);
+    error = filename + " is not a distance table";
+    return false;
+  }
+  map_size = info.st_size;
+  map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); //the mapping keeps the file
+  if(map == MAP_FAILED){
+    map = NULL;
+    error = "can't map " + filename;
+    return false;
+  }
+
+  const unsigned char* head = (const unsigned char*)map;
+  if(std::string((const char*)head, 4) != "RRDT" || head[4] != DISTANCE_TABLE_VERSION){
+    error = filename + " is not a distance table this version can read";
+    return false;
+  }
+  if(head[5] != rows || head[6] != cols || head[7] != robots ||
+     readLittle(head + 8, 8) != layout){
+    error = filename + " was made for another board or other goals";
+    return false;
+  }
+  count = readLittle(head + 16, 8);
+  if(map_size != DISTANCE_TABLE_HEADER + count){
+    error = filename + " is truncated";
+    return false;
+  }
+  dist = head + DISTANCE_TABLE_HEADER;
+  return true;
+}
+
+// Written to filename.tmp and renamed over filename, so a reader never
+// maps half a table
+bool Distance_Table::write(const std::string& filename, int rows, int cols, int robots,
+    uint64_t layout, const std::vector<unsigned char>& distances){
+  std::string tmp = filename + ".tmp";
+  std::ofstream ostr(tmp.c_str(), std::ios::binary);
+  if(!ostr) return false;
+  ostr.write("RRDT", 4);
+  ostr.put(DISTANCE_TABLE_VERSION);
+  ostr.put((char)rows);
+  ostr.put((char)cols);
+  ostr.put((char)robots);
+  for(int b = 0; b < 8; ++b) ostr.put((char)(layout >> (8*b)));
+  uint64_t count = distances.size();
+  for(int b = 0; b < 8; ++b) ostr.put((char)(count >> (8*b)));
+  ostr.write((const char*)distances.data(), distances.size());
+  ostr.close();
+  if(!ostr) return false;
+  return rename(tmp.c_str(), filename.c_str()) == 0;
+}
@@ -0,0 +1,206 @@
+#ifndef __distance_table_h_
+#define __distance_table_h_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "solver_core.h"
+
+// ==================================================================
+// ==================================================================
+// Exhaustive distance tables for small boards (-write_table, -table).
+// Every placement of the robots is numbered by Solver_Core::rank()
+// (robot i's cell is digit i in base rows*cols, so placements with two
+// robots in one cell get a number too and are simply never reached) and
+// gets one byte: the fewest moves from it to a placement that satisfies
+// every goal, or TABLE_UNREACHABLE.  Every integer is little endian:
+//
+//   "RRDT"            magic
+//   u8  version       DISTANCE_TABLE_VERSION
+//   u8  rows, cols, robots
+//   u64 layout        Solver_Core::layoutHash() of the walls and goals
+//   u64 count         placements, (rows*cols)^robots
+//   count bytes       the distances, in rank order
+//
+// The header is DISTANCE_TABLE_HEADER bytes, so the distances can be
+// used straight out of the mapped file.
+
+static const unsigned char DISTANCE_TABLE_VERSION = 1;
+static const int DISTANCE_TABLE_HEADER = 4 + 1 + 3 + 8 + 8;
+static const unsigned char TABLE_UNREACHABLE = 0xFF;
+// a table is one byte per placement, so only small boards get one
+static const uint64_t MAX_TABLE_PLACEMENTS = 1ULL << 27;
+
+class Distance_Table {
+public:
+  Distance_Table() : map(NULL), map_size(0), dist(NULL), count(0) {}
+  ~Distance_Table();
+  // maps filename read only, false (with the reason in error) if it can't
+  //  be read or was made for another board shape, layout or goal set
+  bool open(const std::string& filename, int rows, int cols, int robots,
+    uint64_t layout, std::string& error);
+  int distance(uint64_t rank) const { assert (rank < count); return dist[rank]; }
+
+  static bool write(const std::string& filename, int rows, int cols, int robots,
+    uint64_t layout, const std::vector<unsigned char>& distances);
+
+private:
+  Distance_Table(const Distance_Table&);
+  void operator=(const Distance_Table&);
+  void* map;
+  size_t map_size;
+  const unsigned char* dist;
+  uint64_t count;
+};
+
+
+// ==================================================================
+// Implementation of the Solver_Core members that use the tables
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+uint64_t Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::placements() const {
+  uint64_t count = 1;
+  for(int i = 0; i < robots(); ++i){
+    count *= rows()*cols();
+    if(count > MAX_TABLE_PLACEMENTS) return 0;
+  }
+  return count;
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+uint64_t Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::rank(const State& s) const {
+  uint64_t r = 0;
+  for(int i = robots() - 1; i >= 0; --i){
+    r = r * (rows()*cols()) + s.cell[i];
+  }
+  return r;
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+typename Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::State Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::unrank(uint64_t r) const {
+  State s = State();
+  for(int i = 0; i < robots(); ++i){
+    s.cell[i] = r % (rows()*cols());
+    r /= rows()*cols();
+  }
+  return s;
+}
+
+// 64 bit FNV-1a of the shape, every wall stop and the goals: a table is
+// good for any start position, but only on the board it was made for
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+uint64_t Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::layoutHash() const {
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](int v){
+    for(int b = 0; b < 4; ++b){
+      hash ^= (unsigned char)(v >> (8*b));
+      hash *= 1099511628211ULL;
+    }
+  };
+  mix(rows()); mix(cols()); mix(robots());
+  for(int dir = 0; dir < 4; ++dir){
+    for(int c = 0; c < rows()*cols(); ++c) mix(wall_stop[dir][c]);
+  }
+  for(unsigned int g = 0; g < goal_cells.size(); ++g){
+    mix(goal_cells[g]);
+    mix(goal_robots[g]);
+  }
+  return hash;
+}
+
+// Retrograde breadth first search: every solved placement is at distance
+// 0, and a placement one move before a placement at distance d that
+// has none yet is at d+1.  The moves into a placement are found the way
+// Parallel_BFS::parents() finds them.
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+bool Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::write_table(const std::string& filename,
+    uint64_t& solvable, int& deepest){
+  uint64_t count = placements();
+  if(count == 0) return false;
+  std::vector<unsigned char> dist(count, TABLE_UNREACHABLE);
+  std::vector<uint64_t> level, next;
+  for(uint64_t r = 0; r < count; ++r){
+    State s = unrank(r);
+    bool overlap = false;
+    for(int i = 0; i < robots(); ++i){
+      if(occupied(s, s.cell[i], i)) overlap = true;
+    }
+    if(overlap || !solved(s)) continue;
+    dist[r] = 0;
+    level.push_back(r);
+  }
+
+  solvable = level.size();
+  deepest = 0;
+  for(int d = 0; !level.empty(); ++d){
+    assert (d + 1 < TABLE_UNREACHABLE);
+    for(unsigned int q = 0; q < level.size(); ++q){
+      State s = unrank(level[q]);
+      for(int i = 0; i < robots(); ++i){
+        int to = s.cell[i];
+        for(int dir = 0; dir < 4; ++dir){
+          if(slide(s, i, dir) != to) continue; //robot i would not stop here
+          int far = wall_stop[oppositeDir(dir)][to];
+          for(int from = to; from != far; ){
+            from -= step(dir);
+            if(occupied(s, from, i)) break;
+            s.cell[i] = from;
+            uint64_t r = rank(s);
+            if(dist[r] == TABLE_UNREACHABLE){
+              dist[r] = d + 1;
+              next.push_back(r);
+            }
+          }
+          s.cell[i] = to;
+        }
+      }
+    }
+    if(!next.empty()) deepest = d + 1;
+    solvable += next.size();
+    level.swap(next);
+    next.clear();
+  }
+  return Distance_Table::write(filename, rows(), cols(), robots(), layoutHash(), dist);
+}
+
+// Every move that takes s one closer in the table is the first move of
+// a shortest solution, so the solutions are read off with no search
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+void Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::descend(const Distance_Table& table, State& s,
+    int move, int left){
+  if(left == 0){
+    assert (solved(s));
+    found->push_back(arena->record(path, move));
+    return;
+  }
+  for(int i = 0; i < robots(); ++i){
+    int from = s.cell[i];
+    for(int dir = 0; dir < 4; ++dir){
+      int to = slide(s, i, dir);
+      if(to == from) continue;
+      s.cell[i] = to;
+      if(table.distance(rank(s)) == left - 1){
+        path[move] = (PackedMove)((i << 2) | dir);
+        descend(table, s, move+1, left-1);
+      }
+      s.cell[i] = from;
+    }
+  }
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+bool Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::table_solutions(const std::string& filename,
+    int max_moves, Sol_Arena& a, std::vector<Sol_Span>& f, std::string& error){
+  Distance_Table table;
+  if(!table.open(filename, rows(), cols(), robots(), layoutHash(), error)) return false;
+  arena = &a;
+  found = &f;
+  // every distance in the table is a byte, so a higher cap finds no more
+  max_moves = std::min(max_moves, CORE_MAX_MOVES);
+  State s = start_state;
+  int d = table.distance(rank(s));
+  if(d != TABLE_UNREACHABLE && d <= max_moves) descend(table, s, 0, d);
+  return true;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include "external_bfs.h"
+
+// ==================================================================
+// ==================================================================
+// Implementation of the Record_Writer and Record_Reader
+
+int externalProcessId(){
+  return getpid();
+}
+
+bool Record_Writer::open(const std::string& filename){
+  assert (file == NULL);
+  file = fopen(filename.c_str(), "wb");
+  if(file == NULL) return false;
+  buffer.resize(EXTERNAL_IO_BUFFER);
+  used = 0;
+  total = 0;
+  failed = false;
+  return true;
+}
+
+void Record_Writer::flush(){
+  if(used > 0 && fwrite(buffer.data(), 1, used, file) != used) failed = true;
+  used = 0;
+}
+
+void Record_Writer::write(const void* record, size_t size){
+  assert (file != NULL && size <= buffer.size());
+  if(used + size > buffer.size()) flush();
+  memcpy(&buffer[used], record, size);
+  used += size;
+  total += size;
+}
+
+bool Record_Writer::close(bool sync){
+  if(file == NULL) return !failed;
+  flush();
+  if(sync && (fflush(file) != 0 || fsync(fileno(file)) != 0)) failed = true;
+  if(fclose(file) != 0) failed = true;
+  file = NULL;
+  return !failed;
+}
+
+Record_Reader::~Record_Reader(){
+  if(file) fclose(file);
+}
+
+bool Record_Reader::open(const std::string& filename, size_t record_size, size_t buffer_bytes){
+  assert (file == NULL && record_size > 0);
+  file = fopen(filename.c_str(), "rb");
+  if(file == NULL) return false;
+  size = record_size;
+  buffer.resize(std::max((size_t)1, buffer_bytes / size) * size);
+  used = filled = 0;
+  total = 0;
+  return true;
+}
+
+bool Record_Reader::readBytes(void* out, size_t n){
+  char* to = (char*)out;
+  while(n > 0){
+    if(used == filled){
+      filled = fread(buffer.data(), 1, buffer.size(), file);
+      used = 0;
+      if(filled == 0) return false;
+    }
+    size_t some = std::min(n, filled - used);
+    memcpy(to, &buffer[used], some);
+    used += some;
+    total += some;
+    to += some;
+    n -= some;
+  }
+  return true;
+}
@@ -0,0 +1,439 @@
+#ifndef __external_bfs_h_
+#define __external_bfs_h_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "solver_core.h"
+
+// ==================================================================
+// ==================================================================
+// Files of fixed size records for the external-memory BFS, written and
+// read front to back through large buffers, so the disk only ever sees
+// long sequential transfers.
+
+static const size_t EXTERNAL_IO_BUFFER = 1 << 20;
+// most sorted runs merged in one pass (more take a pass per this many)
+static const size_t EXTERNAL_MERGE_FAN = 64;
+
+// in the file names, so runs can share a temp directory
+int externalProcessId();
+
+class Record_Writer {
+public:
+  Record_Writer() : file(NULL), used(0), total(0), failed(false) {}
+  ~Record_Writer() { close(); }
+  bool open(const std::string& filename);
+  void write(const void* record, size_t size);
+  // flushes (and with sync, waits for the disk); false if any of it
+  //  failed to be written
+  bool close(bool sync = false);
+  uint64_t bytes() const { return total; }
+private:
+  Record_Writer(const Record_Writer&);
+  void operator=(const Record_Writer&);
+  void flush();
+  FILE* file;
+  std::vector<char> buffer;
+  size_t used;
+  uint64_t total;
+  bool failed;
+};
+
+class Record_Reader {
+public:
+  Record_Reader() : file(NULL), size(0), used(0), filled(0), total(0) {}
+  ~Record_Reader();
+  // buffer_bytes is rounded down to whole records (at least one)
+  bool open(const std::string& filename, size_t record_size, size_t buffer_bytes);
+  bool read(void* record) { return readBytes(record, size); } //false at the end of the file
+  bool readBytes(void* out, size_t n); //false if the file ends first
+  uint64_t bytes() const { return total; }
+private:
+  Record_Reader(const Record_Reader&);
+  void operator=(const Record_Reader&);
+  FILE* file;
+  size_t size;
+  std::vector<char> buffer;
+  size_t used, filled;
+  uint64_t total;
+};
+
+
+// Merges the sorted files in inputs into out with each key once, leaving
+// out every key that is also in one of the sorted files in exclude, and
+// calls kept(key) for each key written.  Every file is read once, front
+// to back, through its share of buffer_bytes.
+template <class Key>
+bool mergeSorted(const std::vector<std::string>& inputs, const std::vector<std::string>& exclude,
+    const std::string& out, size_t buffer_bytes, Core_Stats& st, std::string& error,
+    const std::function<void(const Key&)>& kept){
+  size_t files = std::max((size_t)1, inputs.size() + exclude.size());
+  size_t share = std::min(EXTERNAL_IO_BUFFER, buffer_bytes / files);
+  std::vector<std::unique_ptr<Record_Reader> > in, ex;
+  for(unsigned int f = 0; f < inputs.size(); ++f){
+    in.push_back(std::unique_ptr<Record_Reader>(new Record_Reader));
+    if(!in.back()->open(inputs[f], sizeof(Key), share)){
+      error = "can't read " + inputs[f];
+      return false;
+    }
+  }
+  for(unsigned int f = 0; f < exclude.size(); ++f){
+    ex.push_back(std::unique_ptr<Record_Reader>(new Record_Reader));
+    if(!ex.back()->open(exclude[f], sizeof(Key), share)){
+      error = "can't read " + exclude[f];
+      return false;
+    }
+  }
+  Record_Writer writer;
+  if(!writer.open(out)){
+    error = "can't write " + out;
+    return false;
+  }
+
+  // the smallest key at the front of any input comes off the heap next
+  typedef std::pair<Key, size_t> Entry;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap;
+  Key k;
+  for(size_t f = 0; f < in.size(); ++f){
+    if(in[f]->read(&k)) heap.push(Entry(k, f));
+  }
+  std::vector<Key> ex_head(ex.size());
+  std::vector<bool> ex_live(ex.size());
+  for(size_t f = 0; f < ex.size(); ++f) ex_live[f] = ex[f]->read(&ex_head[f]);
+
+  bool any = false;
+  Key last = Key();
+  while(!heap.empty()){
+    Entry top = heap.top();
+    heap.pop();
+    if(in[top.second]->read(&k)) heap.push(Entry(k, top.second));
+    if(any && top.first == last) continue;
+    any = true;
+    last = top.first;
+    // the keys come out in order, so each exclude file only moves forward
+    bool old = false;
+    for(size_t f = 0; f < ex.size(); ++f){
+      while(ex_live[f] && ex_head[f] < last) ex_live[f] = ex[f]->read(&ex_head[f]);
+      if(ex_live[f] && ex_head[f] == last) old = true;
+    }
+    if(old) continue;
+    writer.write(&last, sizeof(Key));
+    kept(last);
+  }
+  for(size_t f = 0; f < in.size(); ++f) st.disk_read += in[f]->bytes();
+  for(size_t f = 0; f < ex.size(); ++f) st.disk_read += ex[f]->bytes();
+  if(!writer.close()){
+    error = "can't write " + out;
+    return false;
+  }
+  st.disk_written += writer.bytes();
+  return true;
+}
+
+
+// ==================================================================
+// ==================================================================
+// Breadth first search over a Solver_Core whose levels live on disk
+// (-external).  Each level is a file of packed keys in sorted order.
+// Expanding a level streams it in and collects the successors in a
+// buffer of config.ram_bytes; a full buffer is sorted, deduplicated and
+// written out as a run.  At the end of the level the runs are merged,
+// and a successor is dropped there if it is in any earlier level's file
+// (delayed duplicate detection: nothing is looked up while expanding,
+// the duplicates all go in one streaming pass).  What is left is the
+// next level.  Once a level holds solved states, the states on the
+// shortest solutions are found walking back from them, one level file
+// merge-joined with the candidate parents at a time; those are few
+// enough to keep in RAM, and the solutions are read out forward through
+// them the way Parallel_BFS reads them out of its table.  One thread
+// does all of it, since the disk is what it waits on.  A checkpoint
+// (checkpoint.h) only has to name the level files, so a killed search
+// leaves them behind and a resumed one picks them up where they are.
+
+template <class Core>
+class External_BFS {
+public:
+  typedef typename Core::State State;
+  typedef typename Core::Key Key;
+
+  External_BFS(const Core& c, const External_Config& config);
+  ~External_BFS(); //removes every file it wrote
+  bool run(int max_moves, Sol_Arena& arena, std::vector<Sol_Span>& found, std::string& error);
+  Core_Stats stats() const { return st; }
+  void setCheckpoint(const Checkpoint_Config& c) { checkpoint = c; }
+
+private:
+  int search(int max_moves, std::string& error);
+  int resume(); //in checkpoint.h
+  void save(int depth); //in checkpoint.h
+  bool writeRun(std::vector<Key>& keys, std::string& error);
+  bool mergeLevel(int depth, std::string& error);
+  bool backtrack(int goal_depth, std::string& error);
+  void enumerate(State& s, int depth, int goal_depth, Sol_Arena& arena,
+    std::vector<Sol_Span>& found);
+  std::string fileName(const std::string& kind, uint64_t n) const;
+
+  const Core& core;
+  External_Config config;
+  Checkpoint_Config checkpoint;
+  std::string prefix;
+  std::vector<std::string> levels; //level d's sorted file
+  std::vector<std::string> runs; //the current level's sorted runs
+  uint64_t next_file;
+
+  // the solved states of the first level that has any, and by level the
+  //  states on some shortest solution (sorted)
+  std::vector<Key> goals;
+  std::vector<std::vector<Key> > on_path;
+  PackedMove path[CORE_MAX_MOVES + 1];
+
+  Core_Stats st;
+};
+
+
+template <class Core>
+External_BFS<Core>::External_BFS(const Core& c, const External_Config& cfg) :
+  core(c), config(cfg), next_file(0) {
+  prefix = config.temp_dir + "/rr_external_" + std::to_string(externalProcessId()) + "_";
+  st.key_bytes = sizeof(Key);
+  st.state_bytes = sizeof(State);
+}
+
+template <class Core>
+External_BFS<Core>::~External_BFS(){
+  for(unsigned int f = 0; f < levels.size(); ++f) std::remove(levels[f].c_str());
+  for(unsigned int f = 0; f < runs.size(); ++f) std::remove(runs[f].c_str());
+}
+
+template <class Core>
+std::string External_BFS<Core>::fileName(const std::string& kind, uint64_t n) const {
+  return prefix + kind + std::to_string(n);
+}
+
+template <class Core>
+bool External_BFS<Core>::run(int max_moves, Sol_Arena& arena, std::vector<Sol_Span>& found,
+    std::string& error){
+  assert (max_moves <= CORE_MAX_MOVES);
+  if(core.solved(core.start())){
+    found.push_back(arena.record(NULL, 0));
+    return true;
+  }
+  int goal_depth = search(max_moves, error);
+  if(!error.empty()) return false;
+  if(!checkpoint.filename.empty()) std::remove(checkpoint.filename.c_str());
+  if(goal_depth < 0) return true;
+  if(!backtrack(goal_depth, error)) return false;
+  State s = core.start();
+  enumerate(s, 0, goal_depth, arena, found);
+  return true;
+}
+
+// Expands a level at a time until one has solved states, leaving them in
+// goals; returns that level's depth, or -1 if max_moves is reached first
+// (or a file fails, with error set)
+template <class Core>
+int External_BFS<Core>::search(int max_moves, std::string& error){
+  Key k;
+  int first = resume() + 1;
+  if(first == 1){
+    levels.push_back(fileName("level", 0));
+    Record_Writer start;
+    k = core.key(core.start());
+    if(!start.open(levels[0])){
+      error = "can't write " + levels[0];
+      return -1;
+    }
+    start.write(&k, sizeof(Key));
+    if(!start.close()){
+      error = "can't write " + levels[0];
+      return -1;
+    }
+    st.states = 1;
+    st.table_bytes = sizeof(Key);
+    st.disk_written += sizeof(Key);
+  }
+  std::chrono::steady_clock::time_point saved = std::chrono::steady_clock::now();
+
+  size_t capacity = std::max((size_t)1024, config.ram_bytes / sizeof(Key));
+  std::vector<Key> successors;
+  successors.reserve(capacity);
+  for(int depth = first; depth <= max_moves; ++depth){
+    Record_Reader frontier;
+    if(!frontier.open(levels[depth-1], sizeof(Key), EXTERNAL_IO_BUFFER)){
+      error = "can't read " + levels[depth-1];
+      return -1;
+    }
+    while(frontier.read(&k)){
+      ++st.expanded;
+      State s = core.unkey(k);
+      for(int i = 0; i < core.robots(); ++i){
+        int from = s.cell[i];
+        for(int dir = 0; dir < 4; ++dir){
+          int to = core.slide(s, i, dir);
+          if(to == from) continue;
+          s.cell[i] = to;
+          successors.push_back(core.key(s));
+          s.cell[i] = from;
+          if(successors.size() == capacity && !writeRun(successors, error)) return -1;
+        }
+      }
+    }
+    st.disk_read += frontier.bytes();
+    if(!successors.empty() && !writeRun(successors, error)) return -1;
+    uint64_t before = st.states;
+    if(!mergeLevel(depth, error)) return -1;
+    if(!goals.empty()) return depth;
+    if(st.states == before) break; //nothing new, so nothing deeper either
+    if(!checkpoint.filename.empty() &&
+        std::chrono::steady_clock::now() - saved >= std::chrono::seconds(checkpoint.every_seconds)){
+      save(depth);
+      saved = std::chrono::steady_clock::now();
+    }
+  }
+  return -1;
+}
+
+// The buffer, sorted with its duplicates dropped, as the next run
+template <class Core>
+bool External_BFS<Core>::writeRun(std::vector<Key>& keys, std::string& error){
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::string name = fileName("run", next_file++);
+  runs.push_back(name);
+  Record_Writer writer;
+  if(!writer.open(name)){
+    error = "can't write " + name;
+    return false;
+  }
+  for(size_t k = 0; k < keys.size(); ++k) writer.write(&keys[k], sizeof(Key));
+  if(!writer.close()){
+    error = "can't write " + name;
+    return false;
+  }
+  st.disk_written += writer.bytes();
+  ++st.runs;
+  keys.clear();
+  return true;
+}
+
+// The level's runs, merged (EXTERNAL_MERGE_FAN at a time) into the
+// level's file less every state of an earlier level
+template <class Core>
+bool External_BFS<Core>::mergeLevel(int depth, std::string& error){
+  std::function<void(const Key&)> none = [](const Key&){};
+  while(runs.size() > EXTERNAL_MERGE_FAN){
+    std::vector<std::string> some(runs.begin(), runs.begin() + EXTERNAL_MERGE_FAN);
+    std::string merged = fileName("run", next_file++);
+    runs.erase(runs.begin(), runs.begin() + EXTERNAL_MERGE_FAN);
+    runs.push_back(merged);
+    bool ok = mergeSorted<Key>(some, std::vector<std::string>(), merged, config.ram_bytes, st,
+      error, none);
+    for(unsigned int f = 0; f < some.size(); ++f) std::remove(some[f].c_str());
+    if(!ok) return false;
+  }
+
+  levels.push_back(fileName("level", depth));
+  uint64_t added = 0;
+  std::function<void(const Key&)> kept = [&](const Key& k){
+    ++added;
+    if(core.solved(core.unkey(k))) goals.push_back(k);
+  };
+  std::vector<std::string> earlier(levels.begin(), levels.begin() + depth);
+  bool ok = mergeSorted<Key>(runs, earlier, levels[depth], config.ram_bytes, st, error, kept);
+  for(unsigned int f = 0; f < runs.size(); ++f) std::remove(runs[f].c_str());
+  runs.clear();
+  st.states += added;
+  st.table_bytes += added * sizeof(Key);
+  return ok;
+}
+
+// Level by level back from the goals: the parents of the states on a
+// shortest solution (found the way Parallel_BFS::parents() walks a slide
+// backwards) that are in the level before are on one too
+template <class Core>
+bool External_BFS<Core>::backtrack(int goal_depth, std::string& error){
+  on_path.assign(goal_depth + 1, std::vector<Key>());
+  on_path[goal_depth] = goals; //sorted, as the merge wrote them
+  for(int depth = goal_depth; depth > 1; --depth){
+    std::vector<Key> candidates;
+    for(unsigned int q = 0; q < on_path[depth].size(); ++q){
+      State s = core.unkey(on_path[depth][q]);
+      for(int i = 0; i < core.robots(); ++i){
+        int to = s.cell[i];
+        for(int dir = 0; dir < 4; ++dir){
+          if(core.slide(s, i, dir) != to) continue;
+          int far = core.wallStop(oppositeDir(dir), to);
+          for(int from = to; from != far; ){
+            from -= core.step(dir);
+            if(core.occupied(s, from, i)) break;
+            s.cell[i] = from;
+            candidates.push_back(core.key(s));
+          }
+          s.cell[i] = to;
+        }
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    Record_Reader level;
+    if(!level.open(levels[depth-1], sizeof(Key), EXTERNAL_IO_BUFFER)){
+      error = "can't read " + levels[depth-1];
+      return false;
+    }
+    Key k;
+    size_t c = 0;
+    while(c < candidates.size() && level.read(&k)){
+      while(c < candidates.size() && candidates[c] < k) ++c;
+      if(c < candidates.size() && candidates[c] == k) on_path[depth-1].push_back(k);
+    }
+    st.disk_read += level.bytes();
+  }
+  return true;
+}
+
+// Forward from the start through the states on the shortest solutions,
+// recording every complete path
+template <class Core>
+void External_BFS<Core>::enumerate(State& s, int depth, int goal_depth, Sol_Arena& arena,
+    std::vector<Sol_Span>& found){
+  if(depth == goal_depth){
+    found.push_back(arena.record(path, goal_depth));
+    return;
+  }
+  const std::vector<Key>& next = on_path[depth+1];
+  for(int i = 0; i < core.robots(); ++i){
+    int from = s.cell[i];
+    for(int dir = 0; dir < 4; ++dir){
+      int to = core.slide(s, i, dir);
+      if(to == from) continue;
+      s.cell[i] = to;
+      if(std::binary_search(next.begin(), next.end(), core.key(s))){
+        path[depth] = (PackedMove)((i << 2) | dir);
+        enumerate(s, depth+1, goal_depth, arena, found);
+      }
+      s.cell[i] = from;
+    }
+  }
+}
+
+// The external search for one specialization of the core
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+bool Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::external_solutions(int max_moves,
+    const External_Config& config, Sol_Arena& arena, std::vector<Sol_Span>& found,
+    std::string& error){
+  External_BFS<Solver_Core> bfs(*this, config);
+  bfs.setCheckpoint(checkpoint);
+  bool ok = bfs.run(max_moves, arena, found, error);
+  last_stats = bfs.stats();
+  return ok;
+}
+
+#endif
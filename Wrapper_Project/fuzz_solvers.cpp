@@ -0,0 +1,342 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sys/wait.h>
+
+// ==================================================================================
+// ==================================================================================
+// Differential fuzzing of the solvers: random puzzles are run through every
+// variant with -max_moves <#> -all_solutions, and each variant's shortest
+// length and set of solutions must match the first variant's, and the
+// Wrapper_Project's must be listed in Solution::getKey() order (robot index
+// in decimal, so with -max_robots past 10 robot 11 comes before robot 2).
+// A puzzle they disagree on is shrunk (walls, goals, robots, then rows and columns are
+// taken away while they still disagree) and the smallest one is written out.
+// Stand-alone, so compile it on its own:
+//   g++ fuzz_solvers.cpp -Wall -O2 -std=c++11 -o fuzz_solvers.o
+// The solvers are run through the shell with timeout(1), nothing else needed.
+
+// ==================================================================================
+// A puzzle as the solvers read it, kept as its parts so it can be shrunk
+
+class Fuzz_Piece {
+public:
+  Fuzz_Piece(const std::string &w, int r, int c) : which(w), row(r), col(c) {}
+  std::string which; //robot letter, goal robot (or any), unused for walls
+  int row, col;
+};
+
+class Fuzz_Puzzle {
+public:
+  Fuzz_Puzzle() : rows(0), cols(0) {}
+  void write(const std::string &filename) const;
+  int rows, cols;
+  std::vector<Fuzz_Piece> robots;
+  std::vector<Fuzz_Piece> goals;
+  std::vector<Fuzz_Piece> horizontal_walls; //just south of (row,col)
+  std::vector<Fuzz_Piece> vertical_walls; //just east of (row,col)
+};
+
+void Fuzz_Puzzle::write(const std::string &filename) const {
+  std::ofstream ostr(filename.c_str());
+  ostr << rows << " " << cols << std::endl;
+  for (unsigned int i = 0; i < robots.size(); ++i)
+    ostr << "robot " << robots[i].which << " " << robots[i].row << " " << robots[i].col << std::endl;
+  for (unsigned int i = 0; i < horizontal_walls.size(); ++i)
+    ostr << "horizontal_wall " << horizontal_walls[i].row << ".5 " << horizontal_walls[i].col << std::endl;
+  for (unsigned int i = 0; i < vertical_walls.size(); ++i)
+    ostr << "vertical_wall " << vertical_walls[i].row << " " << vertical_walls[i].col << ".5" << std::endl;
+  for (unsigned int i = 0; i < goals.size(); ++i)
+    ostr << "goal " << goals[i].which << " " << goals[i].row << " " << goals[i].col << std::endl;
+}
+
+// rows and cols in [2,max_size], up to max_robots robots and 2 goals in
+// distinct cells, and a wall on about one cell edge in eight
+Fuzz_Puzzle randomPuzzle(std::mt19937 &rng, int max_size, int max_robots){
+  Fuzz_Puzzle p;
+  p.rows = 2 + rng() % (max_size - 1);
+  p.cols = 2 + rng() % (max_size - 1);
+  int cells = p.rows * p.cols;
+  std::vector<bool> taken(cells, false);
+  std::string letters = std::string("ABCDEFGHIJKLMNOP").substr(0, std::max(8, max_robots));
+  int num_robots = 1 + rng() % std::min(max_robots, cells);
+  for (int i = 0; i < num_robots; ++i) {
+    int cell;
+    do { cell = rng() % cells; } while (taken[cell]);
+    taken[cell] = true;
+    std::string letter(1, letters[rng() % letters.size()]);
+    letters.erase(letters.find(letter), 1);
+    p.robots.push_back(Fuzz_Piece(letter, cell / p.cols + 1, cell % p.cols + 1));
+  }
+  std::vector<bool> goal_taken(cells, false);
+  int num_goals = 1 + rng() % 2;
+  for (int i = 0; i < num_goals; ++i) {
+    int cell;
+    do { cell = rng() % cells; } while (goal_taken[cell]);
+    goal_taken[cell] = true;
+    std::string which = rng() % 2 ? std::string("any") : p.robots[rng() % p.robots.size()].which;
+    p.goals.push_back(Fuzz_Piece(which, cell / p.cols + 1, cell % p.cols + 1));
+  }
+  for (int r = 1; r < p.rows; ++r)
+    for (int c = 1; c <= p.cols; ++c)
+      if (rng() % 8 == 0) p.horizontal_walls.push_back(Fuzz_Piece("", r, c));
+  for (int r = 1; r <= p.rows; ++r)
+    for (int c = 1; c < p.cols; ++c)
+      if (rng() % 8 == 0) p.vertical_walls.push_back(Fuzz_Piece("", r, c));
+  return p;
+}
+
+// ==================================================================================
+// Running a variant and reading back what it printed
+
+class Fuzz_Variant {
+public:
+  Fuzz_Variant(const std::string &n, const std::string &b, const std::string &a, bool k = true)
+    : name(n), binary(b), args(a), key_order(k) {}
+  std::string name;
+  std::string binary; //run as <binary> <puzzle> -max_moves <#> -all_solutions <args>
+  std::string args;
+  bool key_order; //lists its solutions in getKey() order (not the Base_Project)
+};
+
+class Fuzz_Result {
+public:
+  Fuzz_Result() : timed_out(false), listed(false) {}
+  std::string header; //"N different K move solutions:" or the no solutions line
+  std::set<std::string> solutions; //each one's moves, joined
+  std::vector<std::string> keys; //each one's getKey(), in the order printed
+  bool timed_out;
+  bool listed; //printed its solutions, not just how many (-count_only)
+};
+
+Fuzz_Result runVariant(const Fuzz_Variant &v, const Fuzz_Puzzle &p, const std::string &puzzle,
+                       int max_moves, int timeout_s){
+  std::ostringstream cmd;
+  cmd << "timeout " << timeout_s << " " << v.binary << " " << puzzle << " -max_moves " << max_moves
+      << " -all_solutions " << v.args << " 2>/dev/null";
+  Fuzz_Result result;
+  FILE* out = popen(cmd.str().c_str(), "r");
+  if (out == NULL) {
+    std::cerr << "ERROR: could not run " << cmd.str() << std::endl;
+    exit(0);
+  }
+  std::string line, moves, key;
+  char buf[4096];
+  while (fgets(buf, sizeof(buf), out)) {
+    line = buf;
+    if (!line.empty() && line[line.size()-1] == '\n') line.erase(line.size()-1);
+    if (line.find(" move solutions:") != std::string::npos || line.compare(0, 12, "no solutions") == 0) {
+      result.header = line;
+    } else if (line.compare(0, 6, "robot ") == 0) {
+      moves += line.substr(6) + ";";
+      // "robot <letter> moves <direction>", the robot by its index in the file
+      std::istringstream words(line.substr(6));
+      std::string letter, verb, direction;
+      words >> letter >> verb >> direction;
+      for (unsigned int i = 0; i < p.robots.size(); ++i)
+        if (p.robots[i].which == letter) key += std::to_string(i) + direction;
+    } else if (line.compare(0, 29, "All goals are satisfied after") == 0) {
+      result.solutions.insert(moves);
+      result.keys.push_back(key);
+      result.listed = true;
+      moves.clear();
+      key.clear();
+    }
+  }
+  int status = pclose(out);
+  result.timed_out = WIFEXITED(status) && WEXITSTATUS(status) == 124;
+  return result;
+}
+
+// ==================================================================================
+// Comparing the variants on one puzzle
+
+// what went wrong, or "" if every variant that finished agrees with the
+// first one to list its solutions (whose header is left in agreed)
+std::string disagreement(const std::vector<Fuzz_Variant> &variants, const Fuzz_Puzzle &p,
+                         const std::string &puzzle_file, int max_moves, int timeout_s,
+                         std::string* agreed = NULL){
+  p.write(puzzle_file);
+  std::vector<Fuzz_Result> results;
+  int reference = -1;
+  for (unsigned int v = 0; v < variants.size(); ++v) {
+    results.push_back(runVariant(variants[v], p, puzzle_file, max_moves, timeout_s));
+    if (reference < 0 && !results[v].timed_out && results[v].listed) reference = v;
+  }
+  if (agreed != NULL) *agreed = reference < 0 ? "" : results[reference].header;
+  for (unsigned int v = 0; v < variants.size(); ++v) {
+    const Fuzz_Result &r = results[v];
+    if (r.timed_out) continue; //too slow is not wrong, just skipped
+    if (r.header == "") return variants[v].name + " printed no result (crashed?)";
+    if (variants[v].key_order && !std::is_sorted(r.keys.begin(), r.keys.end())) {
+      return variants[v].name + " lists its solutions out of getKey() order";
+    }
+    if (reference < 0 || (int)v == reference) continue;
+    const Fuzz_Result &ref = results[reference];
+    if (r.header != ref.header) {
+      return variants[v].name + " says \"" + r.header + "\", " + variants[reference].name +
+        " says \"" + ref.header + "\"";
+    }
+    if (r.listed && r.solutions != ref.solutions) {
+      return variants[v].name + " and " + variants[reference].name + " list different solutions";
+    }
+  }
+  return "";
+}
+
+// takes pieces away while the variants still disagree, one at a time
+Fuzz_Puzzle shrink(const std::vector<Fuzz_Variant> &variants, Fuzz_Puzzle p,
+                   const std::string &puzzle_file, int max_moves, int timeout_s){
+  bool smaller = true;
+  while (smaller) {
+    smaller = false;
+    std::vector<Fuzz_Puzzle> tries;
+    for (unsigned int i = 0; i < p.horizontal_walls.size(); ++i) {
+      Fuzz_Puzzle t = p;
+      t.horizontal_walls.erase(t.horizontal_walls.begin() + i);
+      tries.push_back(t);
+    }
+    for (unsigned int i = 0; i < p.vertical_walls.size(); ++i) {
+      Fuzz_Puzzle t = p;
+      t.vertical_walls.erase(t.vertical_walls.begin() + i);
+      tries.push_back(t);
+    }
+    for (unsigned int i = 0; p.goals.size() > 1 && i < p.goals.size(); ++i) {
+      Fuzz_Puzzle t = p;
+      t.goals.erase(t.goals.begin() + i);
+      tries.push_back(t);
+    }
+    // a robot can go if no goal names it
+    for (unsigned int i = 0; p.robots.size() > 1 && i < p.robots.size(); ++i) {
+      bool named = false;
+      for (unsigned int g = 0; g < p.goals.size(); ++g) named |= p.goals[g].which == p.robots[i].which;
+      if (named) continue;
+      Fuzz_Puzzle t = p;
+      t.robots.erase(t.robots.begin() + i);
+      tries.push_back(t);
+    }
+    // and the last row or column if nothing stands in it
+    for (int dim = 0; dim < 2; ++dim) {
+      Fuzz_Puzzle t = p;
+      int &size = dim == 0 ? t.rows : t.cols;
+      if (size <= 2) continue;
+      --size;
+      bool used = false;
+      for (unsigned int i = 0; i < t.robots.size(); ++i)
+        used |= t.robots[i].row > t.rows || t.robots[i].col > t.cols;
+      for (unsigned int i = 0; i < t.goals.size(); ++i)
+        used |= t.goals[i].row > t.rows || t.goals[i].col > t.cols;
+      if (used) continue;
+      std::vector<Fuzz_Piece> kept;
+      for (unsigned int i = 0; i < t.horizontal_walls.size(); ++i)
+        if (t.horizontal_walls[i].row < t.rows && t.horizontal_walls[i].col <= t.cols) kept.push_back(t.horizontal_walls[i]);
+      t.horizontal_walls = kept;
+      kept.clear();
+      for (unsigned int i = 0; i < t.vertical_walls.size(); ++i)
+        if (t.vertical_walls[i].row <= t.rows && t.vertical_walls[i].col < t.cols) kept.push_back(t.vertical_walls[i]);
+      t.vertical_walls = kept;
+      tries.push_back(t);
+    }
+    for (unsigned int t = 0; t < tries.size() && !smaller; ++t) {
+      if (disagreement(variants, tries[t], puzzle_file, max_moves, timeout_s) != "") {
+        p = tries[t];
+        smaller = true;
+      }
+    }
+  }
+  return p;
+}
+
+// ==================================================================================
+// ==================================================================================
+
+bool usage(const std::string &executable_name) {
+  std::cerr << "Usage: " << executable_name << " [-runs <#>] [-seed <#>] [-max_size <#>] [-max_moves <#>]" << std::endl;
+  std::cerr << "       [-max_robots <#>] [-timeout <seconds>] [-dir <directory>]" << std::endl;
+  std::cerr << "       [-variant <name> \"<binary> [<args>]\"]..." << std::endl;
+  std::cerr << "       (with no -variant, the Base_Project and Wrapper_Project main.o are compared" << std::endl;
+  std::cerr << "        with and without -core, -bfs and -count_only; build them first; every" << std::endl;
+  std::cerr << "        -variant must list its solutions in getKey() order)" << std::endl;
+  exit(0);
+}
+
+int main(int argc, char* argv[]) {
+  int runs = 100;
+  unsigned int seed = time(NULL);
+  int max_size = 8; //16 is the largest the solvers are built for
+  int max_moves = 5; //keeps the recursive solvers quick on the bigger boards
+  int max_robots = 4; //16 is the most the Wrapper_Project is built for
+  int timeout_s = 20;
+  std::string dir = "/tmp";
+  std::vector<Fuzz_Variant> variants;
+
+  for (int arg = 1; arg < argc; arg++) {
+    std::string flag = argv[arg];
+    if (flag == "-variant") {
+      if (arg + 2 >= argc) usage(argv[0]);
+      std::string name = argv[arg+1], command = argv[arg+2];
+      size_t space = command.find(' ');
+      if (space == std::string::npos) variants.push_back(Fuzz_Variant(name, command, ""));
+      else variants.push_back(Fuzz_Variant(name, command.substr(0, space), command.substr(space + 1)));
+      arg += 2;
+      continue;
+    }
+    if (arg + 1 >= argc) usage(argv[0]);
+    std::string value = argv[++arg];
+    if (flag == "-runs") runs = atoi(value.c_str());
+    else if (flag == "-seed") seed = strtoul(value.c_str(), NULL, 10);
+    else if (flag == "-max_size") max_size = atoi(value.c_str());
+    else if (flag == "-max_moves") max_moves = atoi(value.c_str());
+    else if (flag == "-max_robots") max_robots = atoi(value.c_str());
+    else if (flag == "-timeout") timeout_s = atoi(value.c_str());
+    else if (flag == "-dir") dir = value;
+    else usage(argv[0]);
+  }
+  if (runs < 1 || max_size < 2 || max_size > 16 || max_moves < 1 || max_robots < 1 ||
+      max_robots > 16 || timeout_s < 1) {
+    usage(argv[0]);
+  }
+  if (variants.empty()) {
+    variants.push_back(Fuzz_Variant("base", "../Base_Project/main.o", "", false));
+    variants.push_back(Fuzz_Variant("threads", "./main.o", ""));
+    variants.push_back(Fuzz_Variant("core", "./main.o", "-core"));
+    variants.push_back(Fuzz_Variant("bfs", "./main.o", "-bfs"));
+    variants.push_back(Fuzz_Variant("count", "./main.o", "-count_only"));
+  }
+
+  std::cout << "seed " << seed << ", " << runs << " puzzles up to " << max_size << "x" << max_size
+            << " with up to " << max_robots << " robots, " << variants.size() << " variants" << std::endl;
+  std::string puzzle_file = dir + "/fuzz_puzzle.txt";
+  int failures = 0, solvable = 0;
+  for (int run = 0; run < runs; ++run) {
+    // every puzzle has its own seed, so one can be made again on its own
+    std::mt19937 rng(seed + run);
+    Fuzz_Puzzle p = randomPuzzle(rng, max_size, max_robots);
+    std::string agreed;
+    std::string what = disagreement(variants, p, puzzle_file, max_moves, timeout_s, &agreed);
+    if (agreed.find(" move solutions:") != std::string::npos) ++solvable;
+    if (what == "") continue;
+    ++failures;
+    std::ostringstream name, full_name;
+    name << dir << "/fuzz_fail_" << seed + run << ".txt";
+    full_name << dir << "/fuzz_fail_" << seed + run << "_full.txt";
+    p.write(full_name.str());
+    std::cout << "puzzle " << run << " (-seed " << seed + run << " -runs 1, " << full_name.str()
+              << "): " << what << std::endl;
+    Fuzz_Puzzle small = shrink(variants, p, puzzle_file, max_moves, timeout_s);
+    small.write(name.str());
+    std::cout << "  shrunk to " << name.str() << ": "
+              << disagreement(variants, small, puzzle_file, max_moves, timeout_s) << std::endl;
+  }
+  std::cout << failures << " of " << runs << " puzzles disagree (" << solvable
+            << " have solutions in " << max_moves << " or fewer moves)" << std::endl;
+  return failures > 0 ? 1 : 0;
+}
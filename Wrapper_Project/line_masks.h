@@ -0,0 +1,61 @@
+#ifndef __line_masks_h_
+#define __line_masks_h_
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// ==================================================================
+// ==================================================================
+// One bitmask per row and per column of a board, so a slide finds its
+// stop cell with a count of trailing or leading zeros instead of a walk
+// cell by cell.  Bit c of row r and bit r of column c are both the cell
+// (r+1,c+1).  A board keeps one set for where the robots are and, for
+// the walls, one with the cells that have a wall on their east side
+// (read by row) and one with the cells that have one on their south
+// side (read by column).
+
+typedef uint64_t Line_Mask;
+static const int LINE_MASK_BITS = 64;
+
+inline Line_Mask lineBit(int k){ return (Line_Mask)1 << k; }
+inline int lowestBit(Line_Mask m){ return __builtin_ctzll(m); }
+inline int highestBit(Line_Mask m){ return LINE_MASK_BITS - 1 - __builtin_clzll(m); }
+static_assert(sizeof(Line_Mask) == sizeof(unsigned long long), "the builtins above are for unsigned long long");
+
+class Line_Masks {
+public:
+  Line_Masks() { clear(); }
+  void clear() { memset(rows, 0, sizeof(rows)); memset(cols, 0, sizeof(cols)); }
+  void add(int r, int c) { rows[r] |= lineBit(c); cols[c] |= lineBit(r); }
+  void remove(int r, int c) { rows[r] &= ~lineBit(c); cols[c] &= ~lineBit(r); }
+  Line_Mask row(int r) const { return rows[r]; }
+  Line_Mask col(int c) const { return cols[c]; }
+private:
+  Line_Mask rows[LINE_MASK_BITS];
+  Line_Mask cols[LINE_MASK_BITS];
+};
+
+// Where a robot at bit k of a line stops sliding toward the higher bits
+// (east along a row, south down a column): on the first cell from k on
+// with a wall on its far side, or just before the first robot past k.
+// The border wall is in walls, so there always is a stop.
+inline int slideHigh(Line_Mask walls, Line_Mask robots, int k){
+  Line_Mask w = walls & ~(lineBit(k) - 1);
+  Line_Mask b = robots & ~(lineBit(k) - 1) & ~lineBit(k);
+  int stop = lowestBit(w);
+  if(b) stop = std::min(stop, lowestBit(b) - 1);
+  return stop;
+}
+
+// The same toward the lower bits (west, north): just past the nearest
+// cell before k with a wall on its far side or a robot in it, or bit 0
+inline int slideLow(Line_Mask walls, Line_Mask robots, int k){
+  Line_Mask w = walls & (lineBit(k) - 1);
+  Line_Mask b = robots & (lineBit(k) - 1);
+  int stop = w ? highestBit(w) + 1 : 0;
+  if(b) stop = std::max(stop, highestBit(b) + 1);
+  return stop;
+}
+
+#endif
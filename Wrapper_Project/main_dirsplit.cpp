@@ -1,11 +1,15 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <iterator>
 #include <cstdlib>
 #include <string>
 #include <cassert>
 
 #include "board_dirsplit.h"
+#include "solver_core.h" //CORE_MAX_MOVES, External_Config
+#include "solver_daemon.h"
+#include "profile.h"
 #include <ctime>          // Timekeeping
 #include <ratio>          // Timekeeping
 #include <chrono>         // Timekeeping
@@ -21,19 +25,20 @@ using std::chrono::system_clock;
 using std::chrono::duration;
 high_resolution_clock::time_point start_time = high_resolution_clock::now();
 int time_first = 1;
+int time_quiet = 0; //nothing but the results may go to stdout (-format bin, -deterministic)
 
 duration<double, std::milli> delta(std::string msg = ""){
   duration<double, std::milli> del;
   int silent = 0;
-  if(msg == ""){silent = 1;}
+  if(msg == "" || time_quiet){silent = 1;}
   if(time_first){
     start_time = high_resolution_clock::now();
     time_first = 0;
-    del = (high_resolution_clock::now() - high_resolution_clock::now()) / 1000;
+    del = duration<double, std::milli>::zero();
   }
   else{
-    del = (high_resolution_clock::now() - start_time) / 1000;
-    if(!silent){std::cout << "  " << msg << ": " << del.count() << " s" << std::endl;}
+    del = high_resolution_clock::now() - start_time; //in ms, printed in s
+    if(!silent){std::cout << "  " << msg << ": " << del.count() / 1000 << " s" << std::endl;}
     start_time = high_resolution_clock::now();
   }
   return del;
@@ -51,9 +56,89 @@ bool usage(const std::string &executable_name) {
   std::cerr << "       " << executable_name << " <puzzle_file> -max_moves <#>" << std::endl;
   std::cerr << "       " << executable_name << " <puzzle_file> -all_solutions" << std::endl;
   std::cerr << "       " << executable_name << " <puzzle_file> -max_moves <#> -all_solutions" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -core" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -bfs [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -time_budget <ms>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above] -stats" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions [-core | -bfs] -format <text | bin>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -count_only [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions -external [-ram_budget <MB>] [-temp_dir <dir>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_solutions [-bfs | -count_only | -external] -checkpoint <file> [-checkpoint_every <s>] [-resume]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] -all_targets [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above but -external, -write_table, -table and -verify_hashes] -mem_limit <MB>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> -write_table <file>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [-max_moves <#>] [-all_solutions] -table <file>" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above but -stats] -deterministic" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above] -fixed_order" << std::endl;
+  std::cerr << "       " << executable_name << " <puzzle_file> [options above] -verify_hashes" << std::endl;
+  std::cerr << "       " << executable_name << " -daemon <socket> [-workers <#>] [-cache <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " -send <socket> <puzzle_file> [-priority <#>] [-max_moves <#>] [-core | -bfs | -count_only] [-threads <#>]" << std::endl;
+  std::cerr << "       " << executable_name << " -send <socket> [-stats | -shutdown]" << std::endl;
   exit(0);
 }
 
+// -daemon <socket> [-workers <#>] [-cache <#>]: serves puzzles until it
+//  is sent -shutdown (solver_daemon.h)
+int daemon_main(int argc, char* argv[]) {
+  if (argc < 3) usage(argv[0]);
+  Daemon_Config config;
+  config.socket_path = argv[2];
+  for (int arg = 3; arg < argc; arg++) {
+    if (argv[arg] == std::string("-workers")) {
+      // the next command line arg is how many requests are solved at once
+      arg++;
+      if (arg == argc) usage(argv[0]);
+      config.workers = atoi(argv[arg]);
+      if (config.workers < 1) usage(argv[0]);
+    } else if (argv[arg] == std::string("-cache")) {
+      // the next command line arg is how many boards (and answers) are kept
+      arg++;
+      if (arg == argc) usage(argv[0]);
+      if (atoi(argv[arg]) < 1) usage(argv[0]);
+      config.cache_entries = atoi(argv[arg]);
+    } else {
+      std::cerr << "ERROR: unknown daemon argument " << argv[arg] << std::endl;
+      usage(argv[0]);
+    }
+  }
+  Solver_Daemon server(config);
+  std::string error;
+  if (!server.listenOn(error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    exit(0);
+  }
+  std::cout << "solving on " << config.socket_path << " with " << config.workers << " workers" << std::endl;
+  server.run();
+  return 0;
+}
+
+// -send <socket> <puzzle_file> [solve options], -stats or -shutdown: one
+//  request to a daemon, with its answer printed
+int send_main(int argc, char* argv[]) {
+  if (argc < 4) usage(argv[0]);
+  std::string request;
+  if (argv[3] == std::string("-stats") && argc == 4) request = "stats\n";
+  else if (argv[3] == std::string("-shutdown") && argc == 4) request = "shutdown\n";
+  else {
+    std::ifstream istr(argv[3], std::ios::binary);
+    if (!istr.good()) {
+      std::cerr << "ERROR: could not open " << argv[3] << " for reading" << std::endl;
+      usage(argv[0]);
+    }
+    // the options are checked by the daemon
+    request = "solve";
+    for (int arg = 4; arg < argc; arg++) request += std::string(" ") + argv[arg];
+    request += "\n";
+    request.append(std::istreambuf_iterator<char>(istr), std::istreambuf_iterator<char>());
+  }
+  std::string error;
+  if (!sendDaemonRequest(argv[2], request, std::cout, error)) {
+    std::cerr << "ERROR: " << error << std::endl;
+    exit(0);
+  }
+  return 0;
+}
+
 // ==================================================================================
 // ==================================================================================
 
@@ -64,17 +149,163 @@ int main(int argc, char* argv[]) {
     usage(argv[0]);
   }
 
+  // or it is a daemon, or a request to one
+  if (argv[1] == std::string("-daemon")) return daemon_main(argc, argv);
+  if (argv[1] == std::string("-send")) return send_main(argc, argv);
+
   // By default, the maximum number of moves is unlimited
   int max_moves = -1;
 
   // By default, output one solution using the minimum number of moves
   bool all_solutions = false;
 
+  // By default, search with the threaded recursive solver
+  bool use_core = false;
+  bool use_bfs = false;
+  bool count_only = false;
+  bool all_targets = false;
+
+  // The breadth first search uses one worker per hardware thread unless told
+  int num_threads = std::thread::hardware_concurrency();
+  if(num_threads < 1) num_threads = 1;
+
+  // By default, one_solution searches until it has the shortest solution
+  int time_budget = -1;
+
+  // By default, no per-thread report after the search threads are joined
+  bool show_stats = false;
+
+  // By default, all_solutions prints text; -format bin packs it (sol_format.h)
+  bool binary_output = false;
+
+  // By default, the time each search took is printed after its results
+  bool deterministic = false;
+
+  // By default, the search threads try the most promising moves first
+  bool move_ordering = true;
+
+  // By default, the threads trust their state hashes without checking them
+  bool verify_hashes = false;
+
+  // By default, the breadth first search keeps its levels in RAM;
+  //  -external puts them on disk (external_bfs.h)
+  bool use_external = false;
+  bool external_options = false;
+  External_Config external;
+
+  // By default, the breadth first searches are never checkpointed
+  //  (checkpoint.h)
+  Checkpoint_Config checkpoint;
+  bool checkpoint_options = false;
+
+  // By default, the searches' tables grow as far as they need to
+  size_t mem_limit = 0;
+
+  // By default, no distance table is written or read (distance_table.h)
+  std::string write_table;
+  std::string table;
+
   // Read in the other command line arguments
   for (int arg = 2; arg < argc; arg++) {
     if (argv[arg] == std::string("-all_solutions")) {
       // find all solutions to the puzzle that use the fewest number of moves
       all_solutions = true;
+    } else if (argv[arg] == std::string("-core")) {
+      // search with the packed core specialized for the board's shape
+      use_core = true;
+    } else if (argv[arg] == std::string("-bfs")) {
+      // search the core's states breadth first, level by level in parallel
+      use_bfs = true;
+    } else if (argv[arg] == std::string("-count_only")) {
+      // just count the shortest solutions (by the breadth first search)
+      count_only = true;
+    } else if (argv[arg] == std::string("-external")) {
+      // breadth first with every level in a sorted file on disk
+      use_external = true;
+    } else if (argv[arg] == std::string("-ram_budget")) {
+      // the next command line arg is how many MB -external may sort in
+      arg++;
+      assert (arg < argc);
+      int mb = atoi(argv[arg]);
+      assert (mb > 0);
+      external.ram_bytes = (size_t)mb << 20;
+      external_options = true;
+    } else if (argv[arg] == std::string("-temp_dir")) {
+      // the next command line arg is where -external writes its files
+      arg++;
+      assert (arg < argc);
+      external.temp_dir = argv[arg];
+      external_options = true;
+    } else if (argv[arg] == std::string("-checkpoint")) {
+      // the next command line arg is the file the search checkpoints to
+      arg++;
+      assert (arg < argc);
+      checkpoint.filename = argv[arg];
+    } else if (argv[arg] == std::string("-checkpoint_every")) {
+      // the next command line arg is the fewest seconds between checkpoints
+      arg++;
+      assert (arg < argc);
+      checkpoint.every_seconds = atoi(argv[arg]);
+      assert (checkpoint.every_seconds >= 0);
+      checkpoint_options = true;
+    } else if (argv[arg] == std::string("-mem_limit")) {
+      // the next command line arg is how many MB the tables of states may take
+      arg++;
+      assert (arg < argc);
+      int mb = atoi(argv[arg]);
+      assert (mb > 0);
+      mem_limit = (size_t)mb << 20;
+    } else if (argv[arg] == std::string("-resume")) {
+      // carry on from the checkpoint file if there is one
+      checkpoint.resume = true;
+      checkpoint_options = true;
+    } else if (argv[arg] == std::string("-all_targets")) {
+      // fewest moves for every robot to every cell, by one breadth first search
+      all_targets = true;
+    } else if (argv[arg] == std::string("-threads")) {
+      // the next command line arg is the number of breadth first workers
+      arg++;
+      assert (arg < argc);
+      num_threads = atoi(argv[arg]);
+      assert (num_threads > 0);
+    } else if (argv[arg] == std::string("-format")) {
+      // the next command line arg is text (the default) or bin
+      arg++;
+      assert (arg < argc);
+      if (argv[arg] == std::string("bin")) binary_output = true;
+      else if (argv[arg] != std::string("text")) usage(argv[0]);
+    } else if (argv[arg] == std::string("-deterministic")) {
+      // leave everything that depends on timing out of stdout, so runs
+      //  can be diffed byte for byte
+      deterministic = true;
+    } else if (argv[arg] == std::string("-fixed_order")) {
+      // try moves in the plain north, west, south, east order (to compare)
+      move_ordering = false;
+    } else if (argv[arg] == std::string("-write_table")) {
+      // the next command line arg is where to write the distance to the
+      //  goals from every placement of the robots
+      arg++;
+      assert (arg < argc);
+      write_table = argv[arg];
+    } else if (argv[arg] == std::string("-table")) {
+      // the next command line arg is a table -write_table made, to read
+      //  the solutions off instead of searching
+      arg++;
+      assert (arg < argc);
+      table = argv[arg];
+    } else if (argv[arg] == std::string("-verify_hashes")) {
+      // keep every state with its hash in the threads' dedup table and
+      //  report the collisions on stderr
+      verify_hashes = true;
+    } else if (argv[arg] == std::string("-stats")) {
+      // report what each search thread did after they are joined
+      show_stats = true;
+    } else if (argv[arg] == std::string("-time_budget")) {
+      // the next command line arg is how many ms one_solution may take
+      arg++;
+      assert (arg < argc);
+      time_budget = atoi(argv[arg]);
+      assert (time_budget >= 0);
     } else if (argv[arg] == std::string("-max_moves")) {
       // the next command line arg is an integer, a cap on the  # of moves
       arg++;
@@ -88,17 +319,116 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  // Load the puzzle board from the input file
+  // The core and the breadth first search only find all solutions
+  if ((use_core || use_bfs) && !all_solutions) {
+    usage(argv[0]);
+  }
+  // The time budget is only for the single solution search
+  if (time_budget >= 0 && all_solutions) {
+    usage(argv[0]);
+  }
+
+  // Binary output is only for all_solutions, and has stdout to itself
+  if (binary_output && (!all_solutions || show_stats)) {
+    usage(argv[0]);
+  }
+  // Counting is an all_solutions mode with nothing to put in a binary file
+  if (count_only && (!all_solutions || binary_output)) {
+    usage(argv[0]);
+  }
+  // Every target at once is its own mode, with text output only
+  if (all_targets && (all_solutions || time_budget >= 0 || binary_output)) {
+    usage(argv[0]);
+  }
+  // Writing a table is its own mode, and a table replaces the searches
+  if (!write_table.empty() && (all_solutions || all_targets || time_budget >= 0 ||
+      max_moves != -1 || binary_output || show_stats || !table.empty())) {
+    usage(argv[0]);
+  }
+  if (!table.empty() && (all_targets || time_budget >= 0 || count_only ||
+      use_core || use_bfs || show_stats)) {
+    usage(argv[0]);
+  }
+  // The external search is an all_solutions mode of its own
+  if (use_external && (!all_solutions || use_core || use_bfs || count_only || !table.empty())) {
+    usage(argv[0]);
+  }
+  if (external_options && !use_external) {
+    usage(argv[0]);
+  }
+  // Only the breadth first searches stop at level barriers to checkpoint
+  if (!checkpoint.filename.empty() && (!all_solutions || !table.empty() ||
+      !(use_bfs || count_only || use_external))) {
+    usage(argv[0]);
+  }
+  if (checkpoint_options && checkpoint.filename.empty()) {
+    usage(argv[0]);
+  }
+  // The limit is for the searches that keep their states in RAM, and its
+  //  tables keep moves in a byte like the core's
+  if (mem_limit && (use_external || !write_table.empty() || !table.empty() || verify_hashes ||
+      max_moves > CORE_MAX_MOVES)) {
+    usage(argv[0]);
+  }
+  // The core keeps its depths and paths in bytes (-core, the -time_budget
+  //  search that runs on it and the breadth first searches of its states,
+  //  in RAM or on disk), and so does the binary output's header
+  if (max_moves > CORE_MAX_MOVES && (use_core || time_budget >= 0 || use_bfs || count_only ||
+      use_external || all_targets || binary_output)) {
+    std::cerr << "ERROR: -max_moves above " << CORE_MAX_MOVES
+              << " is only for the threaded search with text output" << std::endl;
+    usage(argv[0]);
+  }
+  // The stats are all timings and thread ids
+  if (deterministic && show_stats) {
+    usage(argv[0]);
+  }
+  if (binary_output || deterministic) {
+    time_quiet = 1;
+  }
+
+  // Load the puzzle board from the input file (sizing the dedup table
+  //  for it, unless every state is to be checked against its hash)
+  Sol_Singleton::getInstance()->setVerifyHashes(verify_hashes);
+  Sol_Singleton::getInstance()->setMemLimit(mem_limit);
+  Sol_Singleton::getInstance()->setMaxMoves(max_moves);
   Board_Threads boards_obj;
   boards_obj.set_orig_board(argv[0],argv[1]);
+  boards_obj.setShowStats(show_stats);
+  boards_obj.setDeterministic(deterministic);
+  boards_obj.setBinaryOutput(binary_output);
+  boards_obj.setMoveOrdering(move_ordering);
+  if (!checkpoint.filename.empty()) boards_obj.setCheckpoint(checkpoint);
+  if (mem_limit) boards_obj.setMemLimit(mem_limit);
 
   Board_Threads::Board& original = boards_obj.getOrig();
-/*
-  if(!all_solutions && max_moves != -1){
+  if(!write_table.empty()){
+    delta();
+    boards_obj.write_table(write_table);
+    delta("time to write the distance table");
+  }
+
+  else if(all_targets){
+    //print initial board
+    original.print();
+
+    //Same cap as all_solutions (every level up to it is searched, though)
+    if(max_moves == -1){
+      max_moves = original.getCols() + original.getRows();
+      if(max_moves > 12){ //caps max_moves so it doesn't take too long
+        max_moves = 12;
+      }
+    }
+    delta();
+    boards_obj.all_targets(max_moves, num_threads);
+    delta("time to reach all targets");
+  }
+
+  else if(!all_solutions && max_moves != -1){
     //Prints out one solution (the shortest, or one of the shortest in the case of ties)
 
     //print initial board
-    // board.print();
+    original.print();
 
     //Check to make sure there are robots and goals
     if(original.numRobots() == 0 || original.numGoals() == 0){
@@ -106,7 +436,11 @@ int main(int argc, char* argv[]) {
     }
     else{
       //Call the one_solution recursive driver function
-      boards_obj.one_solution(max_moves, true);
+      delta();
+      if(!table.empty()) boards_obj.table_solutions(table, max_moves, true, false);
+      else if(time_budget >= 0) boards_obj.anytime_solution(max_moves, true, time_budget);
+      else boards_obj.one_solution(max_moves, true);
+      delta("time to solve one_solution with finite moves");
     }
   }
 
@@ -114,7 +448,7 @@ int main(int argc, char* argv[]) {
     //Prints out one solution (the shortest, or one of the shortest in the case of ties)
 
     //print initial board
-    // board.print();
+    original.print();
 
     //Algorithm for finding the max_moves
     max_moves = original.getCols() + original.getRows();
@@ -128,11 +462,15 @@ int main(int argc, char* argv[]) {
     }
     else{
       //Call the one_solution recursive driver function
-      boards_obj.one_solution(max_moves, false);
+      delta();
+      if(!table.empty()) boards_obj.table_solutions(table, max_moves, false, false);
+      else if(time_budget >= 0) boards_obj.anytime_solution(max_moves, false, time_budget);
+      else boards_obj.one_solution(max_moves, false);
+      delta("time to solve one_solution with unlimited moves");
     }
   }
-*/
-  if(all_solutions && max_moves != -1){
+
+  else if(all_solutions && max_moves != -1){
     delta();
     // prints out total number of solutions and then all of the shortest solutions
     // intermediate solutions are not printed out
@@ -142,11 +480,17 @@ int main(int argc, char* argv[]) {
 
     //Check to make sure there are robots and goals
     if(original.numRobots() == 0 || original.numGoals() == 0){
-      std::cout << "no solutions with " << max_moves << " or fewer moves" << std::endl;
+      std::vector<Sol_Span> none; //prints the no solutions message (or binary result)
+      boards_obj.print_solutions(none, max_moves, true);
     }
     else{
       //Call the all_solutions recursive driver function
-      boards_obj.all_solutions(max_moves, true); //max_moves given
+      if(!table.empty()) boards_obj.table_solutions(table, max_moves, true, true);
+      else if(count_only) boards_obj.count_solutions(max_moves, true, num_threads);
+      else if(use_external) boards_obj.external_solutions(max_moves, true, external);
+      else if(use_bfs) boards_obj.bfs_solutions(max_moves, true, num_threads);
+      else if(use_core) boards_obj.core_solutions(max_moves, true);
+      else boards_obj.all_solutions(max_moves, true); //max_moves given
     
     delta("time to solve all_solutions with finite moves");
     }
@@ -159,7 +503,7 @@ int main(int argc, char* argv[]) {
     // This finds the shortest solutions without a max_moves argument given
 
     //print initial board
-    boards_obj.getOrig().print();
+    if(!binary_output) boards_obj.getOrig().print();
 
     //Algorithm to find maximum number of moves possible
     max_moves = original.getCols() + original.getRows();
@@ -169,15 +513,28 @@ int main(int argc, char* argv[]) {
 
     //Check to make sure there are robots and goals
     if(original.numRobots() == 0 || original.numGoals() == 0){
-      std::cout << "no solutions" << std::endl;
+      std::vector<Sol_Span> none; //prints the no solutions message (or binary result)
+      boards_obj.print_solutions(none, max_moves, false);
     }
     else{
       //Call the all_solutions recursive driver function
-      boards_obj.all_solutions(max_moves, false); //max_moves not given
+      if(!table.empty()) boards_obj.table_solutions(table, max_moves, false, true);
+      else if(count_only) boards_obj.count_solutions(max_moves, false, num_threads);
+      else if(use_external) boards_obj.external_solutions(max_moves, false, external);
+      else if(use_bfs) boards_obj.bfs_solutions(max_moves, false, num_threads);
+      else if(use_core) boards_obj.core_solutions(max_moves, false);
+      else boards_obj.all_solutions(max_moves, false); //max_moves not given
     }
     delta("time to solve all_solutions with unlimited moves!");
   }
 
+
+  if(verify_hashes){
+    std::cerr << "state hash collisions: " << Sol_Singleton::getInstance()->hashCollisions() << std::endl;
+  }
+
+  // profiling builds (-DBOARD_PROFILE) leave their collapsed stacks here
+  PROFILE_WRITE("profile.folded");
 }
 
 // ================================================================
@@ -0,0 +1,105 @@
+#include "profile.h"
+
+#ifdef BOARD_PROFILE
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <mutex>
+
+// ==================================================================
+// ==================================================================
+// One thread's call tree: node 0 is the thread itself, and every other
+// node is a named scope under its parent with the total time spent in it
+
+namespace {
+
+class Profile_Node {
+public:
+  Profile_Node(const char* n, int p) : name(n), parent(p), total_ns(0) {}
+  const char* name;
+  int parent;
+  std::vector<int> children;
+  long long total_ns;
+};
+
+class Profile_Tree {
+public:
+  Profile_Tree(int i) : index(i), current(0) { nodes.push_back(Profile_Node("", -1)); }
+  int index; //order the thread first profiled anything in
+  int current; //innermost open scope
+  std::vector<Profile_Node> nodes;
+};
+
+// trees outlive their threads so they can be written after join()
+std::mutex profileMutex;
+std::vector<Profile_Tree*> profileTrees;
+
+Profile_Tree* threadTree(){
+  thread_local Profile_Tree* tree = NULL;
+  if(tree == NULL){
+    const std::lock_guard<std::mutex> lock(profileMutex);
+    tree = new Profile_Tree(profileTrees.size());
+    profileTrees.push_back(tree);
+  }
+  return tree;
+}
+
+// prints node and everything below it, each with its own (self) time
+void writeNode(std::ostream& ostr, const Profile_Tree& tree, int n, const std::string& stack){
+  const Profile_Node& node = tree.nodes[n];
+  long long self_ns = node.total_ns;
+  for(unsigned int c = 0; c < node.children.size(); ++c){
+    self_ns -= tree.nodes[node.children[c]].total_ns;
+  }
+  if(n != 0 && self_ns >= 1000) ostr << stack << " " << self_ns / 1000 << std::endl;
+  for(unsigned int c = 0; c < node.children.size(); ++c){
+    int child = node.children[c];
+    writeNode(ostr, tree, child, stack + ";" + tree.nodes[child].name);
+  }
+}
+
+}
+
+// ==================================================================
+// Implementation of the Scoped_Timer
+
+Scoped_Timer::Scoped_Timer(const char* name){
+  Profile_Tree* tree = threadTree();
+  // reuse the child of the open scope with this name, or add it
+  Profile_Node& parent = tree->nodes[tree->current];
+  int found = -1;
+  for(unsigned int c = 0; c < parent.children.size() && found < 0; ++c){
+    if(tree->nodes[parent.children[c]].name == name) found = parent.children[c];
+  }
+  if(found < 0){
+    found = tree->nodes.size();
+    tree->nodes[tree->current].children.push_back(found);
+    tree->nodes.push_back(Profile_Node(name, tree->current));
+  }
+  tree->current = found;
+  start = std::chrono::steady_clock::now();
+}
+
+Scoped_Timer::~Scoped_Timer(){
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  Profile_Tree* tree = threadTree();
+  Profile_Node& node = tree->nodes[tree->current];
+  node.total_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  tree->current = node.parent;
+}
+
+void profileWrite(const std::string& filename){
+  std::ofstream ostr(filename.c_str());
+  if(!ostr){
+    std::cerr << "ERROR: could not write the profile to " << filename << std::endl;
+    return;
+  }
+  const std::lock_guard<std::mutex> lock(profileMutex);
+  for(unsigned int t = 0; t < profileTrees.size(); ++t){
+    writeNode(ostr, *profileTrees[t], 0, "thread_" + std::to_string(profileTrees[t]->index));
+  }
+  std::cerr << "profile written to " << filename << std::endl;
+}
+
+#endif
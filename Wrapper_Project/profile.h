@@ -0,0 +1,44 @@
+#ifndef __profile_h_
+#define __profile_h_
+
+// ==================================================================
+// ==================================================================
+// Scoped timers for the hot paths.  Build with -DBOARD_PROFILE and every
+// PROFILE_SCOPE("name") times the rest of its block into a per-thread
+// call tree; profileWrite() then dumps all the trees as collapsed stacks
+// ("thread_3;one_sol_helper;moveRobot 1234", self time in microseconds)
+// that flamegraph.pl or speedscope read directly.  Without the flag the
+// macros expand to nothing and none of this is compiled in.
+
+#ifdef BOARD_PROFILE
+
+#include <chrono>
+#include <string>
+
+class Scoped_Timer {
+public:
+  // name must be a string literal (it is compared by address)
+  explicit Scoped_Timer(const char* name);
+  ~Scoped_Timer();
+private:
+  Scoped_Timer(const Scoped_Timer&);
+  void operator=(const Scoped_Timer&);
+  std::chrono::steady_clock::time_point start;
+};
+
+// writes every thread's collapsed stacks to filename
+void profileWrite(const std::string& filename);
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) Scoped_Timer PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_WRITE(filename) profileWrite(filename)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_WRITE(filename)
+
+#endif
+
+#endif
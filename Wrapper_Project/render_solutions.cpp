@@ -0,0 +1,79 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "sol_format.h"
+
+// ==================================================================================
+// ==================================================================================
+// Turns the binary all_solutions output (-format bin) back into the text
+// print_solutions writes.  Stand-alone, so compile it on its own:
+//   g++ render_solutions.cpp -Wall -O3 -std=c++11 -o render_solutions.o
+
+// direction names by packed direction, as packMove numbers them
+static const char* const direction_names[4] = {"east", "north", "south", "west"};
+
+bool usage(const std::string &executable_name) {
+  std::cerr << "Usage: " << executable_name << " <solutions_file | -> [<puzzle_file>]" << std::endl;
+  std::cerr << "       (given the puzzle file too, the hash in the header is checked against it)" << std::endl;
+  exit(0);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 3) {
+    usage(argv[0]);
+  }
+
+  // read from the file, or from stdin for -
+  std::ifstream file;
+  if (argv[1] != std::string("-")) {
+    file.open(argv[1], std::ios::binary);
+    if (!file) {
+      std::cerr << "ERROR: could not open " << argv[1] << std::endl;
+      exit(0);
+    }
+  }
+  std::istream &istr = file.is_open() ? file : std::cin;
+
+  Sol_Bin_Header header;
+  if (!readSolHeader(istr, header)) {
+    std::cerr << "ERROR: " << argv[1] << " is not a binary solutions file" << std::endl;
+    exit(0);
+  }
+  if (argc == 3 && puzzleHash(argv[2]) != header.puzzle_hash) {
+    std::cerr << "ERROR: these solutions are not for " << argv[2] << std::endl;
+    exit(0);
+  }
+
+  if (header.count == 0 && header.moves_given) {
+    std::cout << "no solutions with " << header.max_moves << " or fewer moves" << std::endl;
+    return 0;
+  }
+  if (header.count == 0) {
+    std::cout << "no solutions" << std::endl;
+    return 0;
+  }
+
+  // the same text print_solutions builds, one solution at a time
+  std::cout << header.count << " different " << header.length <<
+    " move solutions:" << std::endl << std::endl;
+  std::vector<unsigned char> moves(header.length);
+  for (uint32_t s = 0; s < header.count; ++s) {
+    if (header.length > 0 && !istr.read((char*)&moves[0], header.length)) {
+      std::cerr << "ERROR: the solutions file ends after " << s << " solutions" << std::endl;
+      exit(0);
+    }
+    for (int q = 0; q < header.length; ++q) {
+      unsigned int robot = moves[q] >> 2;
+      if (robot >= header.robots.size()) {
+        std::cerr << "ERROR: solution " << s << " moves robot " << robot << std::endl;
+        exit(0);
+      }
+      std::cout << "robot " << header.robots[robot] << " moves " << direction_names[moves[q] & 3] << std::endl;
+    }
+    std::cout << "All goals are satisfied after " << header.length <<
+      " moves" << std::endl << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef __sol_format_h_
+#define __sol_format_h_
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+// ==================================================================
+// ==================================================================
+// The binary all_solutions output (-format bin), shared by the solver
+// and render_solutions.cpp.  Every integer is little endian:
+//
+//   "RRSB"            magic
+//   u8  version       SOL_BIN_VERSION
+//   u64 puzzle hash   puzzleHash() of the puzzle file
+//   u8  moves given   1 if -max_moves was on the command line
+//   u8  max moves     the cap the search ran with (main turns away caps
+//                     above CORE_MAX_MOVES with -format bin)
+//   u8  robots        then one letter per robot, in robot index order
+//   u8  length        of the shortest solutions
+//   u32 count         of shortest solutions (0 for no solutions)
+//   count * length    packed moves, robot << 2 | direction (see packMove)
+//
+// The solutions are in getKey() order, the order the text is printed in
+// (not the packed bytes' order once there are ten or more robots).
+
+static const unsigned char SOL_BIN_VERSION = 1;
+
+class Sol_Bin_Header {
+public:
+  Sol_Bin_Header() : puzzle_hash(0), moves_given(false), max_moves(0), length(0), count(0) {}
+  uint64_t puzzle_hash;
+  bool moves_given;
+  int max_moves;
+  std::string robots;
+  int length;
+  uint32_t count;
+};
+
+// 64 bit FNV-1a of a file's bytes, so results can be matched to puzzles
+inline uint64_t puzzleHash(const std::string &filename){
+  std::ifstream istr(filename.c_str(), std::ios::binary);
+  uint64_t hash = 14695981039346656037ULL;
+  char c;
+  while(istr.get(c)){
+    hash ^= (unsigned char)c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// the same of a puzzle already read in (for puzzles sent to -daemon)
+inline uint64_t puzzleTextHash(const std::string &text){
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t i = 0; i < text.size(); ++i){
+    hash ^= (unsigned char)text[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+inline void writeSolHeader(std::ostream &ostr, const Sol_Bin_Header &h){
+  ostr.write("RRSB", 4);
+  ostr.put(SOL_BIN_VERSION);
+  for(int b = 0; b < 8; ++b) ostr.put((char)(h.puzzle_hash >> (8*b)));
+  ostr.put(h.moves_given ? 1 : 0);
+  ostr.put((char)h.max_moves);
+  ostr.put((char)h.robots.size());
+  ostr.write(h.robots.data(), h.robots.size());
+  ostr.put((char)h.length);
+  for(int b = 0; b < 4; ++b) ostr.put((char)(h.count >> (8*b)));
+}
+
+// false if the stream does not start with a header this version can read
+inline bool readSolHeader(std::istream &istr, Sol_Bin_Header &h){
+  char magic[4];
+  if(!istr.read(magic, 4) || std::string(magic, 4) != "RRSB") return false;
+  if(istr.get() != SOL_BIN_VERSION) return false;
+  h.puzzle_hash = 0;
+  for(int b = 0; b < 8; ++b) h.puzzle_hash |= (uint64_t)(unsigned char)istr.get() << (8*b);
+  h.moves_given = istr.get() != 0;
+  h.max_moves = (unsigned char)istr.get();
+  int robots = (unsigned char)istr.get();
+  h.robots.assign(robots, ' ');
+  istr.read(&h.robots[0], robots);
+  h.length = (unsigned char)istr.get();
+  h.count = 0;
+  for(int b = 0; b < 4; ++b) h.count |= (uint32_t)(unsigned char)istr.get() << (8*b);
+  return (bool)istr;
+}
+
+#endif
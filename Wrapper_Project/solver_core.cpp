@@ -0,0 +1,105 @@
+#include "solver_core.h"
+#include "bfs_solver.h"
+#include "distance_table.h"
+#include "external_bfs.h"
+#include "checkpoint.h"
+
+// ==================================================================
+// ==================================================================
+// Implementation of the Depth_Table
+
+template <class Key>
+const unsigned char Depth_Table<Key>::EMPTY;
+
+template <class Key>
+Depth_Table<Key>::Depth_Table(size_t max_bytes) : replaced(0), dropped(0), count(0), max_capacity(0) {
+  unsigned int first = 1 << 16;
+  if(max_bytes){
+    max_capacity = PROBE_WINDOW;
+    while(2 * (size_t)max_capacity * (sizeof(Key) + 1) <= max_bytes) max_capacity *= 2;
+    first = std::min(first, max_capacity);
+  }
+  resize(first);
+}
+
+template <class Key>
+void Depth_Table<Key>::resize(unsigned int capacity){
+  std::vector<Key> old_keys;
+  std::vector<unsigned char> old_depths;
+  old_keys.swap(keys);
+  old_depths.swap(depths);
+  keys.assign(capacity, Key());
+  depths.assign(capacity, EMPTY);
+  count = 0;
+  for(unsigned int i = 0; i < old_keys.size(); ++i){
+    if(old_depths[i] != EMPTY) seenShallower(old_keys[i], old_depths[i]);
+  }
+}
+
+template <class Key>
+bool Depth_Table<Key>::seenShallower(const Key& key, int move){
+  unsigned int mask = keys.size() - 1;
+  unsigned int slot = (unsigned int)((keyHash(key) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  bool capped = keys.size() == max_capacity;
+  unsigned int deepest = slot;
+  for(unsigned int probe = 0; depths[slot] != EMPTY && keys[slot] != key; ++probe){
+    if(depths[slot] > depths[deepest]) deepest = slot;
+    if(capped && probe + 1 == PROBE_WINDOW){
+      if(depths[deepest] < move){
+        ++dropped;
+        return false;
+      }
+      keys[deepest] = key;
+      depths[deepest] = move;
+      ++replaced;
+      return false;
+    }
+    slot = (slot + 1) & mask; //linear probing
+  }
+  if(depths[slot] == EMPTY){
+    keys[slot] = key;
+    depths[slot] = move;
+    // keep the table at most half full, up to the cap
+    if(++count * 2 > keys.size() && !capped) resize(keys.size() * 2);
+    return false;
+  }
+  if(depths[slot] < move) return true;
+  depths[slot] = move;
+  return false;
+}
+
+// one per key width the cores below use
+template class Depth_Table<uint64_t>;
+template class Depth_Table<Wide_Key<2> >;
+template class Depth_Table<Wide_Key<4> >;
+
+
+// ==================================================================
+// ==================================================================
+// The specializations compiled in for the common board shapes; every
+// other puzzle gets the smallest generic tier that holds it.  The tiers'
+// keys are 64 bits (8 bit cells), 128 (10 bit cells, 6 to a word) and
+// 256 (12 bit cells, 5 to a word).
+
+static_assert(BOARD_MAX_DIM <= 64 && BOARD_MAX_ROBOTS <= 16,
+  "the largest generic core is 64x64 with 16 robots");
+
+template class Solver_Core<16,16,4>;
+template class Solver_Core<16,16,5>;
+template class Solver_Core<4,7,3>;   // puzzle1-3
+template class Solver_Core<5,7,2>;   // puzzle6
+template class Solver_Core<0,0,0,16,8>;
+template class Solver_Core<0,0,0,32,8>;
+template class Solver_Core<0,0,0,64,16>;
+
+Core_Solver* makeCoreSolver(const Board_Threads::Board& board){
+  int rows = board.getRows(), cols = board.getCols(), robots = board.numRobots();
+  if(rows == 16 && cols == 16 && robots == 4) return new Solver_Core<16,16,4>(board);
+  if(rows == 16 && cols == 16 && robots == 5) return new Solver_Core<16,16,5>(board);
+  if(rows == 4 && cols == 7 && robots == 3) return new Solver_Core<4,7,3>(board);
+  if(rows == 5 && cols == 7 && robots == 2) return new Solver_Core<5,7,2>(board);
+  int dim = std::max(rows, cols);
+  if(dim <= 16 && robots <= 8) return new Solver_Core<0,0,0,16,8>(board);
+  if(dim <= 32 && robots <= 8) return new Solver_Core<0,0,0,32,8>(board);
+  return new Solver_Core<0,0,0,64,16>(board);
+}
@@ -0,0 +1,763 @@
+#ifndef __solver_core_h_
+#define __solver_core_h_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include "board_dirsplit.h"
+
+// ==================================================================
+// ==================================================================
+// A packed search core that is specialized at compile time on the
+// board shape.  A state is just the cell (row-major, numbered from 0)
+// each robot is in, and its key packs those cells into as few 64 bit
+// words as hold them: one for every board up to 16x16 with 8 robots.
+// The generic cores read the dimensions and the number of robots at run
+// time and come in size tiers, Solver_Core<0,0,0,MaxDim,MaxRobots>, so
+// that a small board never pays for the widest key.
+
+// bits needed to number the cells of a board with this many cells
+constexpr int cellBits(int cells){
+  return cells <= 2 ? 1 : 1 + cellBits((cells + 1) / 2);
+}
+
+// A state key too wide for one integer: each word holds as many whole
+// cells as fit in it
+template <int Words>
+class Wide_Key {
+public:
+  uint64_t word[Words];
+  bool operator==(const Wide_Key& k) const {
+    for(int w = 0; w < Words; ++w){ if(word[w] != k.word[w]) return false; }
+    return true;
+  }
+  bool operator!=(const Wide_Key& k) const { return !(*this == k); }
+  bool operator<(const Wide_Key& k) const {
+    for(int w = 0; w < Words; ++w){
+      if(word[w] != k.word[w]) return word[w] < k.word[w];
+    }
+    return false;
+  }
+};
+
+// the key type for Words words: a plain integer when one word will do
+template <int Words> struct Key_Type { typedef Wide_Key<Words> type; };
+template <> struct Key_Type<1> { typedef uint64_t type; };
+
+// word w of a key, so key() and unkey() are written once for both
+inline uint64_t& keyWord(uint64_t& key, int){ return key; }
+template <int Words>
+inline uint64_t& keyWord(Wide_Key<Words>& key, int w){ return key.word[w]; }
+
+// what the hash tables spread keys by (they multiply it again, so one
+//  word is used as it is)
+inline uint64_t keyHash(uint64_t key){ return key; }
+template <int Words>
+inline uint64_t keyHash(const Wide_Key<Words>& key){
+  uint64_t h = key.word[0];
+  for(int w = 1; w < Words; ++w){
+    h = (h ^ key.word[w]) * 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 31;
+  }
+  return h;
+}
+
+// keyHash for the standard containers
+class Key_Hasher {
+public:
+  template <class Key>
+  size_t operator()(const Key& key) const { return keyHash(key) * 0x9E3779B97F4A7C15ULL; }
+};
+
+// directions in the packed move order (see packMove)
+enum Core_Dir { CORE_EAST = 0, CORE_NORTH = 1, CORE_SOUTH = 2, CORE_WEST = 3 };
+
+// the direction that undoes dir (east <-> west, north <-> south)
+inline int oppositeDir(int dir){ return 3 - dir; }
+
+class Distance_Table; //distance_table.h
+
+
+// What the last breadth first search of a core kept, for the -stats
+// report of the size tiers (and how its checkpoints went)
+class Core_Stats {
+public:
+  Core_Stats() : states(0), expanded(0), table_bytes(0), state_bytes(0), key_bytes(0),
+    runs(0), disk_written(0), disk_read(0), checkpoints(0), checkpoint_bytes(0),
+    checkpoint_failed(false), resumed_depth(-1), checkpoint_ignored(false),
+    mem_limit(0), replaced(0), dropped(0), out_of_memory(false) {}
+  uint64_t states; //claimed in the visited table
+  uint64_t expanded; //taken off a frontier and moved from
+  uint64_t table_bytes; //the visited table, empty slots and all (on disk, its levels)
+  int state_bytes; //one State in a frontier
+  int key_bytes; //one packed key
+  // the external-memory search only
+  uint64_t runs; //sorted runs of successors written
+  uint64_t disk_written;
+  uint64_t disk_read;
+  // with a Checkpoint_Config: checkpoints written and the size of the
+  //  last one, whether one could not be written, the level a resume
+  //  picked up after (-1 if it started from scratch) and whether there
+  //  was a checkpoint that was not of this search
+  uint64_t checkpoints;
+  uint64_t checkpoint_bytes;
+  bool checkpoint_failed;
+  int resumed_depth;
+  bool checkpoint_ignored;
+  // with -mem_limit: the limit, what the depth first search's table gave
+  //  up at it (see Depth_Table), and whether a breadth first search
+  //  stopped because its table would not fit
+  uint64_t mem_limit;
+  uint64_t replaced;
+  uint64_t dropped;
+  bool out_of_memory;
+};
+
+// Where the external-memory breadth first search (external_bfs.h) keeps
+// its files and how much RAM it may sort successors in
+class External_Config {
+public:
+  External_Config() : ram_bytes(256 << 20), temp_dir("/tmp") {}
+  size_t ram_bytes;
+  std::string temp_dir;
+};
+
+// Where the breadth first searches checkpoint themselves (checkpoint.h)
+// and how often: at the first level barrier every_seconds or more after
+// the last checkpoint, or with every_seconds 0 at every one
+class Checkpoint_Config {
+public:
+  Checkpoint_Config() : every_seconds(60), resume(false) {}
+  std::string filename; //empty for no checkpoints
+  int every_seconds;
+  bool resume; //start from filename's checkpoint if there is one
+};
+
+
+// The interface Board_Threads keeps; set_orig_board() picks the
+// specialization with makeCoreSolver()
+class Core_Solver {
+public:
+  virtual ~Core_Solver() {}
+  virtual std::string name() const = 0;
+  // every shortest solution with at most max_moves moves goes into found
+  virtual void all_solutions(int max_moves, Sol_Arena& arena,
+    std::vector<Sol_Span>& found) = 0;
+  // the same, found by a breadth first search split over num_threads
+  virtual void bfs_solutions(int max_moves, int num_threads, Sol_Arena& arena,
+    std::vector<Sol_Span>& found) = 0;
+  // only the number of those solutions (0 if none) and their length
+  virtual uint64_t count_solutions(int max_moves, int num_threads, int& length) = 0;
+  // for every robot i and cell c (row-major), at i*cells + c: the fewest
+  //  moves that get robot i to c (-1 if it takes more than max_moves) and
+  //  one path that does, all from one breadth first search ignoring goals
+  virtual void all_targets(int max_moves, int num_threads, Sol_Arena& arena,
+    std::vector<int>& depth, std::vector<Sol_Span>& witness) = 0;
+  // anytime search for one solution: every shorter solution found before
+  //  deadline is passed to improved, and the return value is true if the
+  //  search finished, which proves the last one optimal (or that none exists)
+  virtual bool best_solution(int max_moves, std::chrono::steady_clock::time_point deadline,
+    Sol_Arena& arena, const std::function<void(const Sol_Span&)>& improved) = 0;
+  // the distance to the goals from every placement of the robots, written
+  //  to filename (false if the board has too many placements for a table
+  //  or the file can't be written); solvable counts the placements that
+  //  can reach the goals and deepest is the farthest of them
+  virtual bool write_table(const std::string& filename, uint64_t& solvable, int& deepest) = 0;
+  // every shortest solution with at most max_moves moves, read off a table
+  //  write_table made for this board (false, with the reason in error, if
+  //  filename is not one)
+  virtual bool table_solutions(const std::string& filename, int max_moves, Sol_Arena& arena,
+    std::vector<Sol_Span>& found, std::string& error) = 0;
+  // every shortest solution with at most max_moves moves, from a breadth
+  //  first search that keeps its levels in sorted files instead of RAM
+  //  (false, with the reason in error, if the files can't be written)
+  virtual bool external_solutions(int max_moves, const External_Config& config,
+    Sol_Arena& arena, std::vector<Sol_Span>& found, std::string& error) = 0;
+  // what the last all_solutions, bfs_solutions, count_solutions,
+  //  all_targets or external_solutions kept
+  virtual Core_Stats stats() const = 0;
+  // from now on the depth first searches' tables stop growing at half of
+  //  bytes, and a breadth first search that would need more than bytes
+  //  stops with nothing found and out_of_memory set (0 for no limit)
+  virtual void set_mem_limit(size_t bytes) = 0;
+  // checkpoints for bfs_solutions, count_solutions and external_solutions
+  //  from now on; a finished search removes its checkpoint
+  virtual void set_checkpoint(const Checkpoint_Config& config) = 0;
+};
+
+Core_Solver* makeCoreSolver(const Board_Threads::Board& board);
+
+
+// Most moves the core's searches go to: depths are kept in a byte, with
+// 0xFF for none (Depth_Table, Visited_Table), so main turns a higher
+// -max_moves away for them
+static const int CORE_MAX_MOVES = 254;
+
+// Open addressing table from a state key to the fewest moves the state
+// has been reached in so far.  With max_bytes it stops growing there, and
+// from then on a key is only looked for PROBE_WINDOW slots from its home:
+// a state with no slot free there takes the deepest one's if it is
+// reached in no more moves, or else is not kept (Bounded_States' policy)
+template <class Key>
+class Depth_Table {
+public:
+  Depth_Table(size_t max_bytes = 0);
+  // true if key was already reached in fewer than move moves, otherwise
+  // remembers move for it and returns false
+  bool seenShallower(const Key& key, int move);
+  unsigned int size() const { return count; }
+  size_t bytes() const { return keys.size() * (sizeof(Key) + 1); }
+  uint64_t replaced; //entries given up at the cap for a shallower state
+  uint64_t dropped; //states not kept at the cap
+private:
+  void resize(unsigned int capacity);
+  static const unsigned char EMPTY = 0xFF;
+  static const unsigned int PROBE_WINDOW = 8;
+  std::vector<Key> keys;
+  std::vector<unsigned char> depths;
+  unsigned int count;
+  unsigned int max_capacity; //0 for no cap
+};
+
+
+// MaxDim and MaxRobots only size the generic tiers (Rows == 0)
+template <int Rows, int Cols, int NumRobots, int MaxDim = 0, int MaxRobots = 0>
+class Solver_Core : public Core_Solver {
+public:
+  static_assert(Rows || (MaxDim && MaxRobots), "a generic core needs a size tier");
+  static const int MAX_CELLS = Rows ? Rows * Cols : MaxDim * MaxDim;
+  static const int MAX_ROBOTS = NumRobots ? NumRobots : MaxRobots;
+  static const int CELL_BITS = cellBits(MAX_CELLS);
+  static const int CELLS_PER_WORD = 64 / CELL_BITS;
+  static const int KEY_WORDS = (MAX_ROBOTS + CELLS_PER_WORD - 1) / CELLS_PER_WORD;
+  static_assert(MAX_CELLS <= 65536, "a robot's cell must fit in two bytes");
+
+  typedef typename std::conditional<MAX_CELLS <= 256, unsigned char, uint16_t>::type Cell;
+  typedef typename Key_Type<KEY_WORDS>::type Key;
+
+  class State {
+  public:
+    Cell cell[MAX_ROBOTS];
+  };
+
+  Solver_Core(const Board_Threads::Board& board);
+
+  std::string name() const;
+  void all_solutions(int max_moves, Sol_Arena& arena, std::vector<Sol_Span>& found);
+  void bfs_solutions(int max_moves, int num_threads, Sol_Arena& arena,
+    std::vector<Sol_Span>& found); //in bfs_solver.h
+  uint64_t count_solutions(int max_moves, int num_threads, int& length); //in bfs_solver.h
+  void all_targets(int max_moves, int num_threads, Sol_Arena& arena,
+    std::vector<int>& depth, std::vector<Sol_Span>& witness); //in bfs_solver.h
+  bool best_solution(int max_moves, std::chrono::steady_clock::time_point deadline,
+    Sol_Arena& arena, const std::function<void(const Sol_Span&)>& improved);
+  bool write_table(const std::string& filename, uint64_t& solvable, int& deepest); //in distance_table.h
+  bool table_solutions(const std::string& filename, int max_moves, Sol_Arena& arena,
+    std::vector<Sol_Span>& found, std::string& error); //in distance_table.h
+  bool external_solutions(int max_moves, const External_Config& config, Sol_Arena& arena,
+    std::vector<Sol_Span>& found, std::string& error); //in external_bfs.h
+  Core_Stats stats() const { return last_stats; }
+  void set_checkpoint(const Checkpoint_Config& config) { checkpoint = config; }
+  void set_mem_limit(size_t bytes) { mem_limit = bytes; }
+
+  // the dimensions are constants in every specialization but the generic one
+  int rows() const { return Rows ? Rows : run_rows; }
+  int cols() const { return Cols ? Cols : run_cols; }
+  int robots() const { return NumRobots ? NumRobots : run_robots; }
+
+  const State& start() const { return start_state; }
+  Key key(const State& s) const;
+  State unkey(Key k) const; //the state key(s) was made from
+  int slide(const State& s, int robot, int dir) const;
+  bool solved(const State& s) const;
+  // fewest moves that could still solve s (never more than it takes)
+  int lowerBound(const State& s) const;
+
+  // distance table numbering (in distance_table.h): every placement of the
+  //  robots, overlapping or not, is a number below placements(), which is
+  //  0 if there are too many of them for a table
+  uint64_t placements() const;
+  uint64_t rank(const State& s) const;
+  State unrank(uint64_t r) const;
+  uint64_t layoutHash() const;
+
+  // cell geometry for walking a slide backwards
+  int wallStop(int dir, int cell) const { return wall_stop[dir][cell]; }
+  int step(int dir) const;
+  bool occupied(const State& s, int cell, int except) const;
+
+private:
+  void search(State& s, int move, int limit, int last_robot, int last_dir);
+  void boundedSearch(State& s, int move);
+  bool greedySolution(size_t max_states);
+  int aloneSolution(State& s, int robot, int left, PackedMove* moves);
+  void descend(const Distance_Table& table, State& s, int move, int left);
+
+  int run_rows, run_cols, run_robots;
+
+  // where a robot starting in a cell stops in each direction if
+  // there were no other robots on the board
+  Cell wall_stop[4][MAX_CELLS];
+
+  // goal cells and the robot index that must reach each (-1 for any)
+  std::vector<int> goal_cells;
+  std::vector<int> goal_robots;
+  // per goal, fewest slides from each cell to the goal for a robot that
+  //  may stop anywhere along a slide (so other robots are never needed)
+  std::vector<std::vector<unsigned char> > goal_dist;
+
+  State start_state;
+
+  // per-search scratch
+  PackedMove path[CORE_MAX_MOVES + 1];
+  Depth_Table<Key> depths;
+  Sol_Arena* arena;
+  std::vector<Sol_Span>* found;
+  Core_Stats last_stats;
+  Checkpoint_Config checkpoint;
+  size_t mem_limit;
+
+  // best_solution scratch: solutions must be shorter than bound+1
+  int bound;
+  bool timed_out;
+  unsigned long nodes;
+  std::chrono::steady_clock::time_point deadline;
+  const std::function<void(const Sol_Span&)>* improved;
+  // the greedy pass keeps at most this many states, each taking about
+  //  GREEDY_STATE_BYTES in its tree, its hash map and its queue
+  static const size_t GREEDY_STATES = 1 << 22;
+  static const size_t GREEDY_STATE_BYTES = 3 * sizeof(Key) + 64;
+  std::vector<int> alone_came; //aloneSolution's, per cell
+};
+
+
+// ==================================================================
+// Implementation of the templated members
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::Solver_Core(const Board_Threads::Board& board){
+  mem_limit = 0;
+  run_rows = board.getRows();
+  run_cols = board.getCols();
+  run_robots = board.numRobots();
+  assert (rows() == run_rows && cols() == run_cols && robots() == run_robots);
+  assert (run_rows * run_cols <= MAX_CELLS && run_robots <= MAX_ROBOTS);
+
+  // slide from every cell until a wall is hit (the walls never change,
+  //  so this is the only time the board's wall grids are read)
+  for(int r = 1; r <= rows(); ++r){
+    for(int c = 1; c <= cols(); ++c){
+      int north = r, south = r, east = c, west = c;
+      while(!board.getHorizontalWall(north - 0.5, c)) --north;
+      while(!board.getHorizontalWall(south + 0.5, c)) ++south;
+      while(!board.getVerticalWall(r, east + 0.5)) ++east;
+      while(!board.getVerticalWall(r, west - 0.5)) --west;
+      int cell = (r-1)*cols() + (c-1);
+      wall_stop[CORE_NORTH][cell] = (north-1)*cols() + (c-1);
+      wall_stop[CORE_SOUTH][cell] = (south-1)*cols() + (c-1);
+      wall_stop[CORE_EAST][cell] = (r-1)*cols() + (east-1);
+      wall_stop[CORE_WEST][cell] = (r-1)*cols() + (west-1);
+    }
+  }
+
+  for(int i = 0; i < robots(); ++i){
+    Position p = board.getRobotPosition(i);
+    start_state.cell[i] = (p.row-1)*cols() + (p.col-1);
+  }
+  for(unsigned int g = 0; g < board.numGoals(); ++g){
+    Position p = board.getGoalPosition(g);
+    goal_cells.push_back((p.row-1)*cols() + (p.col-1));
+    int which = -1;
+    for(int i = 0; i < robots(); ++i){
+      if(board.getRobot(i) == board.getGoalRobot(g)) which = i;
+    }
+    goal_robots.push_back(which);
+  }
+
+  // breadth first out of each goal: every cell a straight wall-free line
+  //  away from a cell at distance d is at most d+1 slides from the goal
+  for(unsigned int g = 0; g < goal_cells.size(); ++g){
+    std::vector<unsigned char> dist(rows()*cols(), 0xFF);
+    std::vector<int> queue(1, goal_cells[g]);
+    dist[goal_cells[g]] = 0;
+    for(unsigned int q = 0; q < queue.size(); ++q){
+      int c = queue[q];
+      for(int dir = 0; dir < 4; ++dir){
+        for(int p = c; p != wall_stop[dir][c]; ){
+          p += step(dir);
+          if(dist[p] != 0xFF) continue;
+          dist[p] = dist[c] + 1;
+          queue.push_back(p);
+        }
+      }
+    }
+    goal_dist.push_back(dist);
+  }
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+std::string Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::name() const {
+  std::string shape = std::to_string(rows()) + "x" + std::to_string(cols()) +
+    ", " + std::to_string(robots()) + " robots";
+  if(Rows) return "specialized " + shape;
+  return "generic " + shape + " (up to " + std::to_string(MaxDim) + "x" +
+    std::to_string(MaxDim) + ", " + std::to_string(MaxRobots) + " robots)";
+}
+
+// robot i's cell goes in word i / CELLS_PER_WORD (always word 0 for a
+// one word key)
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+typename Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::Key Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::key(const State& s) const {
+  Key k = Key();
+  for(int i = 0; i < robots(); ++i){
+    uint64_t& w = keyWord(k, i / CELLS_PER_WORD);
+    w = (w << CELL_BITS) | s.cell[i];
+  }
+  return k;
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+typename Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::State Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::unkey(Key k) const {
+  State s;
+  for(int i = robots() - 1; i >= 0; --i){
+    uint64_t& w = keyWord(k, i / CELLS_PER_WORD);
+    s.cell[i] = w & ((1ULL << CELL_BITS) - 1);
+    w >>= CELL_BITS;
+  }
+  return s;
+}
+
+// Where robot ends up if it slides in dir: the wall stop, pulled back
+// to just before the nearest robot in the way
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+int Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::slide(const State& s, int robot, int dir) const {
+  int from = s.cell[robot];
+  int to = wall_stop[dir][from];
+  for(int i = 0; i < robots(); ++i){
+    int other = s.cell[i];
+    if(i == robot) continue;
+    switch(dir){
+    case CORE_NORTH: //same column, between to and from
+      if(other < from && other >= to && (from - other) % cols() == 0) to = other + cols();
+      break;
+    case CORE_SOUTH:
+      if(other > from && other <= to && (other - from) % cols() == 0) to = other - cols();
+      break;
+    case CORE_EAST: //same row, so the cells are contiguous
+      if(other > from && other <= to) to = other - 1;
+      break;
+    case CORE_WEST:
+      if(other < from && other >= to) to = other + 1;
+      break;
+    }
+  }
+  return to;
+}
+
+// how far the cell number changes with one step in dir
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+int Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::step(int dir) const {
+  switch(dir){
+  case CORE_NORTH: return -cols();
+  case CORE_SOUTH: return cols();
+  case CORE_EAST: return 1;
+  default: return -1;
+  }
+}
+
+// true if a robot other than except is in cell
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+bool Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::occupied(const State& s, int cell, int except) const {
+  for(int i = 0; i < robots(); ++i){
+    if(i != except && s.cell[i] == cell) return true;
+  }
+  return false;
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+bool Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::solved(const State& s) const {
+  for(unsigned int g = 0; g < goal_cells.size(); ++g){
+    if(goal_robots[g] >= 0){
+      if(s.cell[goal_robots[g]] != goal_cells[g]) return false;
+      continue;
+    }
+    bool any = false; //a '?' goal takes any robot
+    for(int i = 0; i < robots(); ++i){
+      if(s.cell[i] == goal_cells[g]) any = true;
+    }
+    if(!any) return false;
+  }
+  return true;
+}
+
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+int Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::lowerBound(const State& s) const {
+  int most = 0;
+  for(unsigned int g = 0; g < goal_cells.size(); ++g){
+    int d = 0xFF;
+    for(int i = 0; i < robots(); ++i){
+      if(goal_robots[g] >= 0 && goal_robots[g] != i) continue;
+      d = std::min(d, (int)goal_dist[g][s.cell[i]]);
+    }
+    most = std::max(most, d);
+  }
+  return most;
+}
+
+// Depth limited search for solutions of exactly limit moves.  A robot
+// never turns straight back (that is never part of a shortest path) and
+// a state already reached in fewer moves is not searched again.
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+void Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::search(State& s, int move, int limit,
+    int last_robot, int last_dir){
+  for(int i = 0; i < robots(); ++i){
+    for(int dir = 0; dir < 4; ++dir){
+      if(i == last_robot && dir == oppositeDir(last_dir)) continue;
+      int from = s.cell[i];
+      int to = slide(s, i, dir);
+      if(to == from) continue;
+
+      s.cell[i] = to;
+      path[move-1] = (PackedMove)((i << 2) | dir);
+      if(solved(s)){
+        if(move == limit) found->push_back(arena->record(path, move));
+      }
+      else if(move < limit && !depths.seenShallower(key(s), move)){
+        search(s, move+1, limit, i, dir);
+      }
+      s.cell[i] = from;
+    }
+  }
+}
+
+// Iterative deepening: the first limit with any solutions is the optimal
+// length, and that pass has found every solution of that length
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+void Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::all_solutions(int max_moves, Sol_Arena& a,
+    std::vector<Sol_Span>& f){
+  arena = &a;
+  found = &f;
+  assert (max_moves <= CORE_MAX_MOVES);
+  if(solved(start_state)){
+    found->push_back(arena->record(path, 0));
+    return;
+  }
+  depths = Depth_Table<Key>(mem_limit / 2);
+  depths.seenShallower(key(start_state), 0);
+  for(int limit = 1; limit <= max_moves && found->empty(); ++limit){
+    State s = start_state;
+    search(s, 1, limit, -1, -1);
+  }
+  last_stats = Core_Stats();
+  last_stats.states = depths.size();
+  last_stats.table_bytes = depths.bytes();
+  last_stats.state_bytes = sizeof(State);
+  last_stats.key_bytes = sizeof(Key);
+  last_stats.mem_limit = mem_limit;
+  last_stats.replaced = depths.replaced;
+  last_stats.dropped = depths.dropped;
+}
+
+// Branch and bound: depth first with the moves that look closest to a
+// solution tried first, so some solution turns up quickly.  Each one found
+// lowers the bound (like *max_moves = move in one_sol_helper) and from
+// then on only shorter ones are searched for.
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+void Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::boundedSearch(State& s, int move){
+  if((++nodes & 1023) == 0 && std::chrono::steady_clock::now() >= deadline){
+    timed_out = true;
+  }
+  if(timed_out) return;
+
+  // every move from s, ordered by the lower bound of where it leads
+  int order[4 * MAX_ROBOTS][3];
+  int count = 0;
+  for(int i = 0; i < robots(); ++i){
+    int from = s.cell[i];
+    for(int dir = 0; dir < 4; ++dir){
+      int to = slide(s, i, dir);
+      if(to == from) continue;
+      s.cell[i] = to;
+      int h = solved(s) ? 0 : std::max(1, lowerBound(s));
+      s.cell[i] = from;
+      int k = count++;
+      for(; k > 0 && order[k-1][0] > h; --k){
+        order[k][0] = order[k-1][0]; order[k][1] = order[k-1][1]; order[k][2] = order[k-1][2];
+      }
+      order[k][0] = h; order[k][1] = i; order[k][2] = dir;
+    }
+  }
+
+  for(int m = 0; m < count && !timed_out; ++m){
+    if(move + order[m][0] > bound) break; //the rest are no better
+    int i = order[m][1], dir = order[m][2];
+    int from = s.cell[i];
+    s.cell[i] = slide(s, i, dir);
+    path[move-1] = (PackedMove)((i << 2) | dir);
+    if(order[m][0] == 0){
+      // a new best; anything found from now on must be shorter
+      Sol_Span best = arena->record(path, move);
+      (*improved)(best);
+      bound = move - 1;
+    }
+    else if(!depths.seenShallower(key(s), move)){
+      boundedSearch(s, move+1);
+    }
+    s.cell[i] = from;
+  }
+}
+
+// Breadth first over the cells robot can get to by itself, the others
+// staying put: the fewest moves (at most left) after which s is solved,
+// with the moves written to moves, or -1
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+int Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::aloneSolution(State& s, int robot,
+    int left, PackedMove* moves){
+  int start = s.cell[robot];
+  // per cell the move that got there first (from cell << 2 | dir), -1 if none has
+  std::vector<int>& came = alone_came;
+  came.assign(rows() * cols(), -1);
+  std::vector<int> level(1, start), next;
+  came[start] = start << 2;
+  int found = -1;
+  for(int d = 1; d <= left && found < 0 && !level.empty(); ++d){
+    next.clear();
+    for(unsigned int q = 0; q < level.size() && found < 0; ++q){
+      for(int dir = 0; dir < 4; ++dir){
+        s.cell[robot] = level[q];
+        int to = slide(s, robot, dir);
+        if(came[to] >= 0) continue;
+        came[to] = (level[q] << 2) | dir;
+        s.cell[robot] = to;
+        if(solved(s)){
+          found = to;
+          break;
+        }
+        if(d + lowerBound(s) <= left) next.push_back(to);
+      }
+    }
+    level.swap(next);
+    if(found < 0) continue;
+    // read the moves back from the cell that solved it
+    for(int cell = found, m = d; m > 0; --m, cell = came[cell] >> 2){
+      moves[m-1] = (PackedMove)((robot << 2) | (came[cell] & 3));
+    }
+    s.cell[robot] = start;
+    return d;
+  }
+  s.cell[robot] = start;
+  return -1;
+}
+
+// Greedy best first: the state that looks closest to a solution (by
+// lowerBound, then by fewer moves) is always moved from next, and from
+// the start and the states one move away every robot is also tried by
+// itself, so a first solution turns up within a few thousand states where
+// the depth first search could wander for a long time.  Each shorter one
+// is reported and lowers bound.  True if it ran out of states that could
+// still beat bound, which proves the last one optimal (or that none
+// exists); false if it stopped at max_states or the deadline.
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+bool Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::greedySolution(size_t max_states){
+  class Node {
+  public:
+    Key key;
+    int parent; //index of the state moved from, -1 for the start
+    PackedMove move; //that got here
+    int moves;
+  };
+  std::vector<Node> tree;
+  // fewest moves each state has been reached in
+  std::unordered_map<Key, int, Key_Hasher> reached;
+  // (lowerBound, moves, index): the smallest comes off first
+  typedef std::tuple<int, int, int> Entry;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+  Node start = {key(start_state), -1, 0, 0};
+  tree.push_back(start);
+  reached[start.key] = 0;
+  open.push(Entry(lowerBound(start_state), 0, 0));
+  while(!open.empty()){
+    if(tree.size() >= max_states || std::chrono::steady_clock::now() >= deadline) return false;
+    int at = std::get<2>(open.top());
+    int least = std::get<1>(open.top()) + std::get<0>(open.top());
+    open.pop();
+    int moves = tree[at].moves;
+    // skip it if it has been reached in fewer moves since, or can no
+    //  longer beat the best
+    if(reached.find(tree[at].key)->second < moves || least > bound) continue;
+    State s = unkey(tree[at].key);
+    for(int i = 0; i < robots() && moves <= 1; ++i){
+      int alone = aloneSolution(s, i, bound - moves, path + moves);
+      if(alone < 0) continue;
+      for(int m = moves, n = at; m > 0; --m, n = tree[n].parent) path[m-1] = tree[n].move;
+      (*improved)(arena->record(path, moves + alone));
+      bound = moves + alone - 1;
+    }
+    for(int i = 0; i < robots(); ++i){
+      int from = s.cell[i];
+      for(int dir = 0; dir < 4; ++dir){
+        int to = slide(s, i, dir);
+        if(to == from) continue;
+        s.cell[i] = to;
+        Key k = key(s);
+        int need = solved(s) ? 0 : std::max(1, lowerBound(s));
+        s.cell[i] = from;
+        if(moves + 1 + need > bound) continue;
+        typename std::unordered_map<Key, int, Key_Hasher>::iterator r = reached.find(k);
+        if(r != reached.end() && r->second <= moves + 1) continue;
+        reached[k] = moves + 1;
+        Node next = {k, at, (PackedMove)((i << 2) | dir), moves + 1};
+        tree.push_back(next);
+        if(need > 0){
+          open.push(Entry(need, moves + 1, tree.size() - 1));
+          continue;
+        }
+        // a new best: read its path back through the parents
+        for(int m = moves + 1, n = tree.size() - 1; m > 0; --m, n = tree[n].parent){
+          path[m-1] = tree[n].move;
+        }
+        (*improved)(arena->record(path, moves + 1));
+        bound = moves;
+      }
+    }
+  }
+  return true;
+}
+
+// The greedy pass first, for an upper bound within milliseconds (and on
+// a small board often the proof as well), then the branch and bound with
+// a fresh table to prove or improve it
+template <int Rows, int Cols, int NumRobots, int MaxDim, int MaxRobots>
+bool Solver_Core<Rows,Cols,NumRobots,MaxDim,MaxRobots>::best_solution(int max_moves,
+    std::chrono::steady_clock::time_point until, Sol_Arena& a,
+    const std::function<void(const Sol_Span&)>& report){
+  arena = &a;
+  improved = &report;
+  deadline = until;
+  assert (max_moves <= CORE_MAX_MOVES);
+  if(solved(start_state)){
+    report(arena->record(path, 0));
+    return true;
+  }
+  bound = max_moves;
+  timed_out = false;
+  nodes = 0;
+  // under -mem_limit the greedy pass gets the half the table would
+  size_t greedy_states = GREEDY_STATES;
+  if(mem_limit) greedy_states = std::min(greedy_states, mem_limit / 2 / GREEDY_STATE_BYTES);
+  if(greedySolution(greedy_states)) return true;
+  depths = Depth_Table<Key>(mem_limit / 2);
+  depths.seenShallower(key(start_state), 0);
+  State s = start_state;
+  boundedSearch(s, 1);
+  return !timed_out;
+}
+
+#endif
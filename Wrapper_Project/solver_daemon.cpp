@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "solver_daemon.h"
+#include "solver_core.h" //CORE_MAX_MOVES
+#include "sol_format.h"
+
+// ==================================================================
+// ==================================================================
+// The socket, for both ends
+
+// all of text, or false if the other end went away (no SIGPIPE)
+static bool sendAll(int fd, const std::string& text){
+  size_t sent = 0;
+  while(sent < text.size()){
+    ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+// everything up to the other end's shutdown, or false if it is more than
+//  limit bytes or the connection fails
+static bool receiveAll(int fd, std::string& text, size_t limit){
+  char buffer[4096];
+  for(;;){
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if(n < 0 && errno == EINTR) continue;
+    if(n < 0) return false;
+    if(n == 0) return true;
+    text.append(buffer, n);
+    if(text.size() > limit) return false;
+  }
+}
+
+// what a non-blocking client has sent so far: 1 once it has shut its side
+//  down, 0 while more is to come, -1 if it is over limit bytes or failed
+static int receiveSome(int fd, std::string& text, size_t limit){
+  char buffer[4096];
+  for(;;){
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if(n < 0 && errno == EINTR) continue;
+    if(n < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    if(n == 0) return 1;
+    text.append(buffer, n);
+    if(text.size() > limit) return -1;
+  }
+}
+
+static bool socketAddress(const std::string& path, sockaddr_un& addr, std::string& error){
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(path.empty() || path.size() >= sizeof(addr.sun_path)){
+    error = "the socket path must be 1 to " + std::to_string(sizeof(addr.sun_path) - 1) + " characters";
+    return false;
+  }
+  strcpy(addr.sun_path, path.c_str());
+  return true;
+}
+
+static double msBetween(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b){
+  return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+bool sendDaemonRequest(const std::string& socket_path, const std::string& request,
+    std::ostream& out, std::string& error){
+  sockaddr_un addr;
+  if(!socketAddress(socket_path, addr, error)) return false;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0){
+    if(fd >= 0) close(fd);
+    error = "no daemon is listening on " + socket_path;
+    return false;
+  }
+  std::string answer;
+  bool ok = sendAll(fd, request) && shutdown(fd, SHUT_WR) == 0 && receiveAll(fd, answer, (size_t)-1);
+  close(fd);
+  out << answer;
+  out.flush();
+  if(!ok) error = "the daemon on " + socket_path + " hung up";
+  return ok;
+}
+
+
+// ==================================================================
+// ==================================================================
+// Implementation of the Daemon_Options
+
+bool Daemon_Options::parse(const std::string& line, std::string& error){
+  std::istringstream istr(line);
+  std::string token;
+  istr >> token; //solve
+  while(istr >> token){
+    int* number = NULL;
+    if(token == "-priority") number = &priority;
+    else if(token == "-max_moves") number = &max_moves;
+    else if(token == "-threads") number = &num_threads;
+    else if(token == "-core") use_core = true;
+    else if(token == "-bfs") use_bfs = true;
+    else if(token == "-count_only") count_only = true;
+    else {
+      error = "unknown option " + token;
+      return false;
+    }
+    if(number && !(istr >> *number)){
+      error = token + " needs a number";
+      return false;
+    }
+  }
+  if(use_core + use_bfs + count_only > 1){
+    error = "-core, -bfs and -count_only are different searches, ask for one";
+    return false;
+  }
+  // one cap for every search: the packed ones keep their depths in bytes
+  if(max_moves != -1 && (max_moves < 1 || max_moves > CORE_MAX_MOVES)){
+    error = "-max_moves must be 1 to " + std::to_string(CORE_MAX_MOVES);
+    return false;
+  }
+  if(num_threads < 1 || num_threads > DAEMON_MAX_THREADS){
+    error = "-threads must be 1 to " + std::to_string(DAEMON_MAX_THREADS);
+    return false;
+  }
+  return true;
+}
+
+std::string Daemon_Options::key() const {
+  const char* search = use_core ? "core" : use_bfs ? "bfs" : count_only ? "count" : "threads";
+  return std::string(search) + " " + std::to_string(max_moves);
+}
+
+
+// ==================================================================
+// ==================================================================
+// Implementation of the Solver_Daemon
+
+Solver_Daemon::Solver_Daemon(const Daemon_Config& config) : config(config), listen_fd(-1),
+    next_seq(0), stopping(false), boards(config.cache_entries), answers(config.cache_entries),
+    solved(0), answer_hits(0), boards_loaded(0), errors(0), total_ms(0), most_ms(0),
+    threads_rows(0), threads_cols(0), threads_robots(0), threads_deep(false) {}
+
+bool Solver_Daemon::listenOn(std::string& error){
+  sockaddr_un addr;
+  if(!socketAddress(config.socket_path, addr, error)) return false;
+  // a socket left behind by a daemon that is gone is taken over, but not
+  //  a live one or anything that is not a socket
+  struct stat held;
+  if(lstat(config.socket_path.c_str(), &held) == 0){
+    if(!S_ISSOCK(held.st_mode)){
+      error = config.socket_path + " is there and is not a socket";
+      return false;
+    }
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    bool live = probe >= 0 && connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0;
+    if(probe >= 0) close(probe);
+    if(live){
+      error = "a daemon is already listening on " + config.socket_path;
+      return false;
+    }
+    unlink(config.socket_path.c_str());
+  }
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listen_fd < 0 || bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0){
+    error = "can't listen on " + config.socket_path + ": " + strerror(errno);
+    if(listen_fd >= 0) close(listen_fd);
+    return false;
+  }
+  return true;
+}
+
+void Solver_Daemon::run(){
+  for(int w = 0; w < config.workers; ++w) workers.push_back(std::thread(&Solver_Daemon::worker, this));
+  int last = accept_loop();
+
+  // the queue is drained before the shutdown is answered
+  {
+    std::lock_guard<std::mutex> lock(queue_lock);
+    stopping = true;
+  }
+  queued.notify_all();
+  for(unsigned int w = 0; w < workers.size(); ++w) workers[w].join();
+  close(listen_fd);
+  unlink(config.socket_path.c_str());
+  if(last >= 0){
+    sendAll(last, "shut down, " + std::to_string(solved) + " requests answered\n");
+    close(last);
+  }
+}
+
+// Collects every client's request side by side, as its bytes come, and
+//  hands each whole one to dispatch(); returns the client that asked for
+//  the shutdown (-1 if accept failed)
+int Solver_Daemon::accept_loop(){
+  fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+  std::vector<Daemon_Pending> pending;
+  for(;;){
+    // wait for a new client, more of a request, or the next deadline
+    std::vector<pollfd> fds(1 + pending.size());
+    fds[0].fd = listen_fd;
+    fds[0].events = POLLIN;
+    int wait_ms = -1;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for(unsigned int p = 0; p < pending.size(); ++p){
+      fds[p+1].fd = pending[p].fd;
+      fds[p+1].events = POLLIN;
+      int left = (int)std::max(0.0, msBetween(now, pending[p].deadline)) + 1;
+      if(wait_ms < 0 || left < wait_ms) wait_ms = left;
+    }
+    if(poll(fds.data(), fds.size(), wait_ms) < 0 && errno != EINTR) return -1;
+
+    now = std::chrono::steady_clock::now();
+    std::vector<Daemon_Pending> waiting;
+    int last = -1;
+    for(unsigned int p = 0; p < pending.size(); ++p){
+      Daemon_Pending& client = pending[p];
+      int got = 0;
+      if(last < 0 && fds[p+1].revents) got = receiveSome(client.fd, client.text, DAEMON_MAX_REQUEST);
+      if(last >= 0) got = -1; //shutting down
+      else if(got == 0 && now >= client.deadline) got = -1;
+      if(got == 0){
+        waiting.push_back(client);
+        continue;
+      }
+      // answers go out blocking, however long the client takes to read them
+      fcntl(client.fd, F_SETFL, fcntl(client.fd, F_GETFL) & ~O_NONBLOCK);
+      if(got < 0){
+        sendAll(client.fd, last >= 0 ? std::string("ERROR: the daemon is shutting down\n") :
+          "ERROR: requests are at most " + std::to_string(DAEMON_MAX_REQUEST) +
+          " bytes and must end within " + std::to_string(DAEMON_READ_SECONDS) + " s\n");
+        close(client.fd);
+      }
+      else if(dispatch(client)) last = client.fd;
+    }
+    pending.swap(waiting);
+    if(last >= 0){
+      for(unsigned int p = 0; p < pending.size(); ++p){
+        sendAll(pending[p].fd, "ERROR: the daemon is shutting down\n");
+        close(pending[p].fd);
+      }
+      return last;
+    }
+
+    for(;;){
+      int fd = accept(listen_fd, NULL, NULL);
+      if(fd < 0 && errno == EINTR) continue;
+      if(fd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+      if(fd < 0) return -1;
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      Daemon_Pending client;
+      client.fd = fd;
+      client.arrived = std::chrono::steady_clock::now();
+      client.deadline = client.arrived + std::chrono::seconds(DAEMON_READ_SECONDS);
+      pending.push_back(client);
+    }
+  }
+}
+
+// Answers stats, or queues a solve; true (with the client left open for
+//  the answer) for a shutdown
+bool Solver_Daemon::dispatch(const Daemon_Pending& client){
+  size_t end = client.text.find('\n');
+  std::string line = client.text.substr(0, end);
+  std::string command = line.substr(0, line.find(' '));
+  if(command == "shutdown") return true;
+  if(command == "stats"){
+    sendAll(client.fd, stats());
+    close(client.fd);
+    return false;
+  }
+
+  Daemon_Request request;
+  std::string error;
+  if(command != "solve") error = "unknown request " + command;
+  else request.options.parse(line, error);
+  if(!error.empty()){
+    sendAll(client.fd, "ERROR: " + error + "\n");
+    close(client.fd);
+    return false;
+  }
+  request.fd = client.fd;
+  request.puzzle = end == std::string::npos ? "" : client.text.substr(end + 1);
+  request.arrived = client.arrived;
+  {
+    std::lock_guard<std::mutex> lock(queue_lock);
+    request.seq = next_seq++;
+    requests.push(request);
+  }
+  queued.notify_one();
+  return false;
+}
+
+void Solver_Daemon::worker(){
+  for(;;){
+    Daemon_Request request;
+    {
+      std::unique_lock<std::mutex> lock(queue_lock);
+      queued.wait(lock, [this]{ return stopping || !requests.empty(); });
+      if(requests.empty()) return; //stopping, and nothing left
+      request = requests.top();
+      requests.pop();
+    }
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::string how;
+    std::string answer = solve(request, how);
+    std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+
+    double total = msBetween(request.arrived, finished);
+    std::ostringstream latency;
+    latency << std::fixed << std::setprecision(3) << "latency: " << msBetween(request.arrived, started)
+      << " ms queued, " << msBetween(started, finished) << " ms solving, " << total << " ms in all ("
+      << how << ")" << std::endl;
+    {
+      std::lock_guard<std::mutex> lock(cache_lock);
+      ++solved;
+      total_ms += total;
+      most_ms = std::max(most_ms, total);
+    }
+    sendAll(request.fd, answer + latency.str());
+    close(request.fd);
+  }
+}
+
+// The board for this puzzle text, loaded (and its core made) only if it
+//  is not in the cache; NULL (with the reason in error) if the text is
+//  not a puzzle, which is not cached
+std::shared_ptr<Daemon_Board> Solver_Daemon::board(const std::string& puzzle, bool& hit,
+    std::string& error){
+  std::shared_ptr<Daemon_Board> held;
+  {
+    std::lock_guard<std::mutex> lock(cache_lock);
+    hit = boards.find(puzzle, held);
+    if(hit) return held;
+  }
+  std::istringstream istr(puzzle);
+  Board_Threads::Board loaded;
+  if(!Board_Threads::parse(istr, loaded, error)) return std::shared_ptr<Daemon_Board>();
+  held.reset(new Daemon_Board);
+  held->solver.use_board(loaded, puzzleTextHash(puzzle));
+  std::lock_guard<std::mutex> lock(cache_lock);
+  boards.insert(puzzle, held);
+  ++boards_loaded;
+  return held;
+}
+
+// What -all_solutions prints for the request, after the board, with
+//  where it came from in how
+std::string Solver_Daemon::solve(const Daemon_Request& request, std::string& how){
+  const Daemon_Options& options = request.options;
+  std::string key = options.key() + "\n" + request.puzzle;
+  std::string answer;
+  {
+    std::lock_guard<std::mutex> lock(cache_lock);
+    if(answers.find(key, answer)){
+      ++answer_hits;
+      how = "answer cached";
+      return answer;
+    }
+  }
+
+  bool hit;
+  std::string error;
+  std::shared_ptr<Daemon_Board> loaded = board(request.puzzle, hit, error);
+  if(!loaded){
+    std::lock_guard<std::mutex> counting(cache_lock);
+    ++errors;
+    how = "not a puzzle";
+    return "ERROR: " + error + "\n";
+  }
+  how = hit ? "board cached" : "board loaded";
+  std::lock_guard<std::mutex> lock(loaded->lock);
+
+  // the same cap as main when -max_moves is not given
+  Board_Threads& solver = loaded->solver;
+  Board_Threads::Board& original = solver.getOrig();
+  bool moves_given = options.max_moves != -1;
+  int max_moves = options.max_moves;
+  if(!moves_given) max_moves = std::min(original.getCols() + original.getRows(), 12);
+
+  std::ostringstream text;
+  solver.setOutput(text);
+  if(original.numRobots() == 0 || original.numGoals() == 0){
+    std::vector<Sol_Span> none;
+    solver.print_solutions(none, max_moves, moves_given);
+  }
+  else if(options.count_only) solver.count_solutions(max_moves, moves_given, options.num_threads);
+  else if(options.use_bfs) solver.bfs_solutions(max_moves, moves_given, options.num_threads);
+  else if(options.use_core) solver.core_solutions(max_moves, moves_given);
+  else {
+    std::lock_guard<std::mutex> one(threads_lock);
+    Sol_Singleton* shared = Sol_Singleton::getInstance();
+    int rows = original.getRows(), cols = original.getCols(), robots = original.numRobots();
+    bool deep = max_moves > Sol_Singleton::DENSE_MAX_MOVES;
+    bool same = rows == threads_rows && cols == threads_cols && robots == threads_robots &&
+      deep == threads_deep;
+    shared->setMaxMoves(max_moves);
+    if(!same) shared->sizeStates(rows, cols, robots);
+    if(same || !shared->denseStates()) shared->clearStates(); //sizeStates only clears a dense table
+    threads_rows = rows;
+    threads_cols = cols;
+    threads_robots = robots;
+    threads_deep = deep;
+    solver.all_solutions(max_moves, moves_given);
+  }
+  solver.setOutput(std::cout);
+
+  answer = text.str();
+  std::lock_guard<std::mutex> caching(cache_lock);
+  answers.insert(key, answer);
+  return answer;
+}
+
+std::string Solver_Daemon::stats(){
+  size_t waiting;
+  {
+    std::lock_guard<std::mutex> lock(queue_lock);
+    waiting = requests.size();
+  }
+  std::lock_guard<std::mutex> lock(cache_lock);
+  std::ostringstream out;
+  out << "requests: " << solved << " answered, " << answer_hits << " from the answer cache, "
+    << errors << " not puzzles" << std::endl;
+  out << "queue: " << waiting << " waiting for " << config.workers << " workers" << std::endl;
+  out << "caches: " << boards.size() << " boards (" << boards_loaded << " loaded in all), "
+    << answers.size() << " answers, of " << config.cache_entries << " each" << std::endl;
+  out << std::fixed << std::setprecision(3) << "latency: " << (solved ? total_ms / solved : 0)
+    << " ms mean, " << most_ms << " ms most" << std::endl;
+  return out.str();
+}
@@ -0,0 +1,190 @@
+#ifndef __solver_daemon_h_
+#define __solver_daemon_h_
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include "board_dirsplit.h"
+
+// ==================================================================
+// ==================================================================
+// The solver as a local server (-daemon <socket>): puzzles come in over
+// a UNIX domain socket, wait in a priority queue and are solved by a pool
+// of workers that stay up, keeping the boards they have loaded (each with
+// its search core) and the answers they have given for the next request.
+//
+// One request is one connection: a first line, then for solve the puzzle
+// in the format Board_Threads::load() reads, then the client shuts its
+// side down and reads the answer until the daemon closes.  The first
+// line is one of
+//
+//   solve [-priority <#>] [-max_moves <#>] [-core | -bfs | -count_only] [-threads <#>]
+//   stats
+//   shutdown
+//
+// Higher priorities are solved first, equal ones in the order they came.
+// A solve is answered with what -all_solutions prints after the board
+// (or "ERROR: ..." if it is not a puzzle) and then the line
+//
+//   latency: <q> ms queued, <s> ms solving, <t> ms in all (<how>)
+//
+// where how is answer cached, board cached, board loaded or not a puzzle
+// (text that is not a puzzle is never cached).  Shutdown waits for the
+// queue to empty.
+
+static const int DAEMON_DEFAULT_WORKERS = 2;
+static const size_t DAEMON_DEFAULT_CACHE = 64;
+// longest request read (the largest puzzles are a few KB)
+static const size_t DAEMON_MAX_REQUEST = 1 << 20;
+// a client that has not sent its whole request in this long is dropped
+//  (the others are read meanwhile)
+static const int DAEMON_READ_SECONDS = 10;
+// most threads one -bfs or -count_only request may start
+static const int DAEMON_MAX_THREADS = 64;
+
+class Daemon_Config {
+public:
+  Daemon_Config() : workers(DAEMON_DEFAULT_WORKERS), cache_entries(DAEMON_DEFAULT_CACHE) {}
+  std::string socket_path;
+  int workers;
+  size_t cache_entries; //boards kept loaded, and answers kept
+};
+
+// What a solve asks for; the threads don't change the answer, so they are
+//  left out of key()
+class Daemon_Options {
+public:
+  Daemon_Options() : priority(0), max_moves(-1), use_core(false), use_bfs(false),
+    count_only(false), num_threads(1) {}
+  bool parse(const std::string& line, std::string& error);
+  std::string key() const;
+  int priority;
+  int max_moves; //-1 if not given
+  bool use_core, use_bfs, count_only;
+  int num_threads; //for -bfs and -count_only (the workers run side by side already)
+};
+
+class Daemon_Request {
+public:
+  int fd; //the client, answered and closed by whoever takes the request
+  uint64_t seq; //arrival order
+  Daemon_Options options;
+  std::string puzzle;
+  std::chrono::steady_clock::time_point arrived;
+};
+
+// A client whose request is still coming in
+class Daemon_Pending {
+public:
+  int fd; //non-blocking until the request is whole
+  std::string text;
+  std::chrono::steady_clock::time_point arrived, deadline;
+};
+
+// lower priority, or the same and later, goes after
+class Daemon_Later {
+public:
+  bool operator()(const Daemon_Request& a, const Daemon_Request& b) const {
+    if(a.options.priority != b.options.priority) return a.options.priority < b.options.priority;
+    return a.seq > b.seq;
+  }
+};
+
+// A loaded puzzle: searched by one request at a time
+class Daemon_Board {
+public:
+  std::mutex lock;
+  Board_Threads solver;
+};
+
+// Least recently used entries go first once there are capacity of them
+template <class Value>
+class Daemon_Cache {
+public:
+  Daemon_Cache(size_t capacity) : capacity(capacity) {}
+  bool find(const std::string& key, Value& value){
+    typename std::unordered_map<std::string, Iterator>::iterator i = index.find(key);
+    if(i == index.end()) return false;
+    order.splice(order.begin(), order, i->second);
+    value = i->second->second;
+    return true;
+  }
+  void insert(const std::string& key, const Value& value){
+    Value held;
+    if(find(key, held)){
+      order.front().second = value;
+      return;
+    }
+    order.push_front(std::make_pair(key, value));
+    index[key] = order.begin();
+    if(order.size() > capacity){
+      index.erase(order.back().first);
+      order.pop_back();
+    }
+  }
+  size_t size() const { return order.size(); }
+private:
+  typedef typename std::list<std::pair<std::string, Value> >::iterator Iterator;
+  size_t capacity;
+  std::list<std::pair<std::string, Value> > order;
+  std::unordered_map<std::string, Iterator> index;
+};
+
+class Solver_Daemon {
+public:
+  Solver_Daemon(const Daemon_Config& config);
+  // false (with the reason in error) if the socket can't be set up
+  bool listenOn(std::string& error);
+  // then serves until a shutdown request
+  void run();
+
+private:
+  Solver_Daemon(const Solver_Daemon&);
+  void operator=(const Solver_Daemon&);
+  int accept_loop();
+  bool dispatch(const Daemon_Pending& client);
+  void worker();
+  std::string solve(const Daemon_Request& request, std::string& how);
+  std::shared_ptr<Daemon_Board> board(const std::string& puzzle, bool& hit, std::string& error);
+  std::string stats();
+
+  Daemon_Config config;
+  int listen_fd;
+
+  std::mutex queue_lock;
+  std::condition_variable queued;
+  std::priority_queue<Daemon_Request, std::vector<Daemon_Request>, Daemon_Later> requests;
+  uint64_t next_seq;
+  bool stopping;
+  std::vector<std::thread> workers;
+
+  // both caches and the counters below are under cache_lock
+  std::mutex cache_lock;
+  Daemon_Cache<std::shared_ptr<Daemon_Board> > boards;
+  Daemon_Cache<std::string> answers;
+  uint64_t solved, answer_hits, boards_loaded, errors;
+  double total_ms, most_ms;
+
+  // the threaded search shares Sol_Singleton's table of states seen, so
+  //  one runs at a time, and the table is only sized again for a new shape
+  //  (or a search too deep for the dense table)
+  std::mutex threads_lock;
+  int threads_rows, threads_cols, threads_robots;
+  bool threads_deep;
+};
+
+// Sends request (the first line and for solve the puzzle) to the daemon
+//  listening on socket_path and copies its answer to out; false (with
+//  the reason in error) if it could not be reached
+bool sendDaemonRequest(const std::string& socket_path, const std::string& request,
+  std::ostream& out, std::string& error);
+
+#endif